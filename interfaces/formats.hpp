@@ -2,6 +2,11 @@
 
 #include <bnb/types/base_types.hpp>
 
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
 namespace bnb::interfaces {
     struct orient_format
     {
@@ -9,4 +14,91 @@ namespace bnb::interfaces {
         bool is_y_flip;
     };
 
+    struct image_rect
+    {
+        int32_t x;
+        int32_t y;
+        int32_t width;
+        int32_t height;
+    };
+
+    enum class scale_filter
+    {
+        nearest,
+        linear,
+        // Box filtered mip chain, better quality for downscaling by 2x and more
+        mipmap,
+    };
+
+    /**
+     * Additional downscaled copy of the output frame, e.g. for simulcast streams.
+     * Produced on the GPU only when requested from pixel_buffer.
+     */
+    struct output_layer
+    {
+        int32_t width;
+        int32_t height;
+        scale_filter filter{scale_filter::linear};
+    };
+
+    /**
+     * Preprocessing of incoming frames, performed on worker threads before the frame
+     * reaches the render thread. Frames are always converted to NV12.
+     */
+    struct input_preparation
+    {
+        // Region of the incoming frame to process, in pixels of the incoming frame
+        std::optional<image_rect> crop;
+        // Frames larger than this are downscaled keeping aspect ratio, 0 means the OEP surface size
+        int32_t max_width{0};
+        int32_t max_height{0};
+    };
+
+    /**
+     * Timing of an incoming frame, carried to the pixel buffer of the processed frame.
+     */
+    struct frame_timing
+    {
+        std::chrono::steady_clock::time_point capture_time;
+        // Frame is dropped before rendering if it can't be delivered by this time
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+    };
+
+    enum class scheduling_policy
+    {
+        // Only the newest queued frame is rendered, older ones are dropped
+        latency_first,
+        // Every queued frame is rendered in order unless it misses its deadline
+        throughput_first,
+    };
+
+    /**
+     * Adaptive processing resolution. When rendering doesn't fit into the frame budget the
+     * surface is scaled down step by step, and back up when there is headroom. Output frames
+     * keep the size set by surface_changed or set_output_size.
+     */
+    struct resolution_governor_config
+    {
+        bool enabled{false};
+        float target_fps{30.0f};
+        // Bounds of the processing scale relative to the surface size
+        float min_scale{0.5f};
+        float max_scale{1.0f};
+        float scale_step{0.125f};
+    };
+
+    /**
+     * Shared memory ring every rendered frame is written to as NV12, for consumers in other
+     * processes. See shm::frame_reader in the shm_frame_ring library for the reading side.
+     */
+    struct shm_output_config
+    {
+        // POSIX shared memory name, e.g. "/oep_frames"
+        std::string name;
+        uint32_t slots{4};
+        // Largest frame a slot holds, 0 means the current output size. Larger frames are skipped
+        int32_t max_width{0};
+        int32_t max_height{0};
+    };
+
 } // bnb::interfaces
\ No newline at end of file
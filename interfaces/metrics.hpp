@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+namespace bnb::interfaces
+{
+    /**
+     * Snapshot of offscreen effect player counters. Counters are cumulative
+     * since creation of the instance, gauges reflect the moment of the snapshot.
+     */
+    struct oep_metrics
+    {
+        // counters
+        uint64_t frames_submitted{0};
+        uint64_t frames_rendered{0};
+        // rendered frames delivered without the effect player while no effect is loaded
+        uint64_t frames_passthrough{0};
+        uint64_t frames_dropped_queue_busy{0};
+        uint64_t frames_dropped_pb_locked{0};
+        uint64_t frames_dropped_draw_timeout{0};
+        uint64_t frames_dropped_deadline{0};
+        uint64_t bytes_read_back{0};
+        uint64_t conversions{0};
+        uint64_t conversion_time_us{0};
+        uint64_t allocations_avoided{0};
+        uint64_t effects_activated{0};
+        // effect loads with files already prefetched by any instance of the process, and without
+        uint64_t effect_prefetch_hits{0};
+        uint64_t effect_prefetch_misses{0};
+        uint64_t resolution_changes{0};
+        uint64_t shm_frames_written{0};
+        // frames larger than a slot of the shared memory output or failed to read
+        uint64_t shm_frames_skipped{0};
+
+        // duration from load_effect call to activation of the last loaded effect
+        uint64_t last_effect_swap_latency_us{0};
+        // duration of synthetic frames rendering after the last effect activation
+        uint64_t last_effect_warmup_us{0};
+        // duration from capture to delivery of the last rendered frame
+        uint64_t last_frame_latency_us{0};
+        // duration from creation of the instance to the first delivered frame, 0 until then
+        uint64_t time_to_first_frame_us{0};
+
+        // gauges
+        // frames waiting for the render thread, frames still being prepared are not counted
+        uint32_t queue_depth{0};
+        uint32_t pixel_buffers_in_flight{0};
+        // current surface size of the effect player, may be lowered by the resolution governor
+        uint32_t processing_width{0};
+        uint32_t processing_height{0};
+    };
+} // bnb::interfaces
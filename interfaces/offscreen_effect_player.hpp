@@ -3,13 +3,17 @@
 #include <bnb/types/full_image.hpp>
 
 #include "formats.hpp"
+#include "metrics.hpp"
 #include "offscreen_render_target.hpp"
 #include "pixel_buffer.hpp"
 
 
 namespace bnb {
 
+    class render_worker_pool;
+
     using oep_pb_ready_cb = std::function<void(std::optional<ipb_sptr>)>;
+    using oep_effect_activated_cb = std::function<void(const std::string& effect_path)>;
 
 namespace interfaces
 {
@@ -20,6 +24,19 @@ namespace interfaces
             const std::vector<std::string>& path_to_resources, const std::string& client_token,
             int32_t width, int32_t height, bool manual_audio, iort_sptr ort);
 
+        /**
+         * Create effect player served by a shared pool of render threads instead of its own thread.
+         * Each instance keeps its render target context, the pool thread switches between them.
+         *
+         * @param render_workers pool to create the render session in, nullptr for own render thread
+         *
+         * Example create({"resources"}, token, 1280, 720, false, ort, render_worker_pool::create(8))
+         */
+        static std::shared_ptr<offscreen_effect_player> create(
+            const std::vector<std::string>& path_to_resources, const std::string& client_token,
+            int32_t width, int32_t height, bool manual_audio, iort_sptr ort,
+            std::shared_ptr<render_worker_pool> render_workers);
+
         virtual ~offscreen_effect_player() = default;
 
         /**
@@ -35,6 +52,80 @@ namespace interfaces
         virtual void process_image_async(std::shared_ptr<full_image_t> image, oep_pb_ready_cb callback,
                                          std::optional<orient_format> target_orient) = 0;
 
+        /**
+         * Same as above, the frame carries its capture time and an optional deadline. A frame that
+         * can't be rendered by the deadline is dropped before any work is spent on it and the
+         * callback is called with std::nullopt. Timing is available from the pixel buffer.
+         *
+         * Example process_image_async(image_sptr, [](ipb_sptr sptr){}, std::nullopt, { capture_time, capture_time + 50ms })
+         */
+        virtual void process_image_async(std::shared_ptr<full_image_t> image, oep_pb_ready_cb callback,
+                                         std::optional<orient_format> target_orient, const frame_timing& timing) = 0;
+
+        /**
+         * An asynchronous method for passing a frame held in a GL texture to effect player.
+         * The texture must belong to a context shared with the offscreen render target
+         * (see offscreen_render_target::get_sharing_context) and must stay unchanged
+         * until the callback is called. The frame read from the texture is cropped and scaled
+         * by set_input_preparation the same way as frames of process_image_async.
+         *
+         * @param texture_id GL_TEXTURE_2D texture with RGBA frame, first row is the top of the image
+         * @param fence GLsync inserted after the texture was written and flushed, may be nullptr.
+         * Ownership is passed to effect player, the fence is deleted after waiting.
+         * @param width width of the texture
+         * @param height height of the texture
+         * @param orientation camera orientation of the frame
+         * @param callback calling when frame will be processed, containing pointer of pixel_buffer for get bytes
+         * @param target_orient
+         *
+         * Example process_texture_async(texture, fence, 1280, 720, bnb::camera_orientation::deg_0, [](ipb_sptr sptr){}, std::nullopt)
+         */
+        virtual void process_texture_async(int32_t texture_id, oep_sync fence, int32_t width, int32_t height,
+                                           camera_orientation orientation, oep_pb_ready_cb callback,
+                                           std::optional<orient_format> target_orient) = 0;
+
+        /**
+         * Same as above with capture time and deadline of the frame, see process_image_async.
+         *
+         * Example process_texture_async(texture, fence, 1280, 720, bnb::camera_orientation::deg_0, [](ipb_sptr sptr){}, std::nullopt, { capture_time })
+         */
+        virtual void process_texture_async(int32_t texture_id, oep_sync fence, int32_t width, int32_t height,
+                                           camera_orientation orientation, oep_pb_ready_cb callback,
+                                           std::optional<orient_format> target_orient, const frame_timing& timing) = 0;
+
+        /**
+         * Choose what to do with frames queued faster than they are rendered. Latency first
+         * (default) renders only the newest frame, throughput first renders all of them in order.
+         * In both cases frames that miss their deadline are dropped. May be called from any thread
+         *
+         * Example set_scheduling_policy(bnb::interfaces::scheduling_policy::throughput_first)
+         */
+        virtual void set_scheduling_policy(scheduling_policy policy) = 0;
+
+        /**
+         * Read frames back on a second thread with its own GL context, so the next frame is
+         * rendered while the previous one is read and converted. Pixel buffer callbacks and
+         * accessors then run on the readback thread. Requires a render target created with
+         * a readback context, disabled by default. May be called from any thread
+         *
+         * Example set_pipelined_readback(true)
+         */
+        virtual void set_pipelined_readback(bool enabled) = 0;
+
+        /**
+         * Write every rendered frame as NV12 into a POSIX shared memory ring, e.g. for an encoder
+         * running in another process. Frames are converted straight into the ring slot, pixel
+         * buffer callbacks are called as usual. May be called from any thread
+         *
+         * @param config ring name and size, std::nullopt to stop writing and remove the ring
+         *
+         * @return false if the shared memory can't be created, always false for a config on Windows,
+         * where shared memory output is not built
+         *
+         * Example set_shm_output(bnb::interfaces::shm_output_config{ "/oep_frames" })
+         */
+        virtual bool set_shm_output(const std::optional<shm_output_config>& config) = 0;
+
         /**
          * Notify about rendering surface being resized.
          * Must be called from the render thread.
@@ -46,15 +137,94 @@ namespace interfaces
          */
         virtual void surface_changed(int32_t width, int32_t height) = 0;
 
+        /**
+         * Set size of processed frames returned through pixel_buffer. Frames are rendered
+         * in the surface size and scaled to the output size on the GPU, so input, processing
+         * and output resolutions are independent. Odd sizes are rounded down to even ones
+         * for NV12 output. May be called from any thread
+         *
+         * @param width output width, 0 to follow the surface size
+         * @param height output height, 0 to follow the surface size
+         *
+         * Example set_output_size(1920, 1080)
+         */
+        virtual void set_output_size(int32_t width, int32_t height) = 0;
+
+        /**
+         * Set downscaled copies of the output frame, e.g. for simulcast. Layers are available
+         * through pixel_buffer layer accessors and are rendered only when requested.
+         * Odd layer sizes are rounded down to even ones. May be called from any thread
+         *
+         * @param layers sizes and scale filters of layers, empty to disable
+         *
+         * Example set_output_layers({{960, 540}, {480, 270, bnb::interfaces::scale_filter::mipmap}})
+         */
+        virtual void set_output_layers(const std::vector<output_layer>& layers) = 0;
+
+        /**
+         * Set up cropping and downscaling of incoming frames. Takes effect for frames
+         * passed to process_image_async after the call. May be called from any thread
+         *
+         * @param preparation crop region and maximum size of frames passed to effect player
+         *
+         * Example set_input_preparation({ bnb::interfaces::image_rect{ 160, 0, 960, 720 }, 640, 480 })
+         */
+        virtual void set_input_preparation(const input_preparation& preparation) = 0;
+
+        /**
+         * Lower the processing resolution when frames take longer than the target frame time
+         * and raise it back when there is headroom, instead of dropping frames. Output frames
+         * keep their size. Disabled by default. May be called from any thread
+         *
+         * @param config target fps and bounds of the processing scale
+         *
+         * Example set_resolution_governor({ true, 30.0f, 0.5f, 1.0f })
+         */
+        virtual void set_resolution_governor(const resolution_governor_config& config) = 0;
+
         /**
          * Load and activate effect async. May be called from any thread
          *
-         * @param effect_path Path to directory of effect
+         * @param effect_path Path to directory of effect, "<effect_path>.bnb" bundle is used if there is no directory
          *
          * Example load_effect("effects/test_BG")
          */
         virtual void load_effect(const std::string& effect_path) = 0;
 
+        /**
+         * Load effect in background while the current effect keeps rendering, the effects
+         * are swapped on a frame boundary once the new one is ready. May be called from any thread
+         *
+         * @param effect_path Path to directory of effect
+         * @param callback called on the render thread when the effect is activated, may be empty
+         *
+         * Example load_effect("effects/test_BG", [](const std::string& path){})
+         */
+        virtual void load_effect(const std::string& effect_path, oep_effect_activated_cb callback) = 0;
+
+        /**
+         * Render synthetic frames offscreen after an effect is loaded, so shader compilation,
+         * texture uploads and script initialization don't slow down the first real frames.
+         * Warm-up frames are rendered one at a time between live frames, the current effect keeps
+         * rendering until the new one is activated. Duration is reported in metrics. May be called from any thread
+         *
+         * @param frames number of frames rendered after the effect activation, 0 disables warm-up
+         *
+         * Example set_effect_warmup_frames(3)
+         */
+        virtual void set_effect_warmup_frames(uint32_t frames) = 0;
+
+        /**
+         * Read effect files into memory in background without activating the effect,
+         * so a following load_effect doesn't wait for the disk. Effect bundle is extracted.
+         * May be called from any thread
+         *
+         * @param effect_path Path to directory of effect
+         *
+         * Example preload_effect("effects/Afro")
+         */
+        virtual void preload_effect(const std::string& effect_path) = 0;
+
         /**
          * Unload effect from cache.
          *
@@ -94,6 +264,22 @@ namespace interfaces
          * Example call_js_method("just_bg", "{ "recordDuration": 15, "rotation_vector": true }")
          */
         virtual void call_js_method(const std::string& method, const std::string& param) = 0;
+
+        /**
+         * Call the callback once all work queued before is done, including readback of rendered frames.
+         * Called on the render or readback thread, doesn't block.
+         *
+         * Example flush([]() { std::cout << "idle" << std::endl; })
+         */
+        virtual void flush(std::function<void()> callback) = 0;
+
+        /**
+         * Snapshot of frame counters, drops by reason, queue depth and readback statistics.
+         * May be called from any thread.
+         *
+         * Example get_metrics().frames_rendered
+         */
+        virtual oep_metrics get_metrics() = 0;
     };
 }
 } // bnb::interfaces
@@ -8,7 +8,28 @@ namespace bnb::interfaces
 {
     // Opaque value, used only to make GL resources sharing between contexts
     using oep_sharing_context = void*;
+    // Opaque value of GLsync fence object
+    using oep_sync = void*;
 
+    /**
+     * Output of a rendered frame copied out of the render target, so it can be read on
+     * the readback thread while next frames are rendered. See publish_frame.
+     */
+    struct published_frame
+    {
+        size_t slot;
+        int32_t texture;
+        int32_t width;
+        int32_t height;
+        // Signalled when the copy is done, nullptr once waited on
+        oep_sync fence;
+    };
+
+    /**
+     * Output scaling, layers, texture input and readback on another thread have default
+     * implementations, so render targets without them keep building. The corresponding
+     * features of the effect player must not be used with such render targets.
+     */
     class offscreen_render_target
     {
     public:
@@ -41,6 +62,30 @@ namespace bnb::interfaces
          */
         virtual void surface_changed(int32_t width, int32_t height) = 0;
 
+        /**
+         * Set size of the output image, the rendered frame is scaled to it on the GPU
+         * during orientation pass. Zero size means the surface size.
+         *
+         * @param width width of the output image
+         * @param height height of the output image
+         *
+         * Example set_output_size(1920, 1080)
+         */
+        virtual void set_output_size(int32_t width, int32_t height)
+        {
+            // Render targets without scaling always output the surface size
+        }
+
+        /**
+         * Set downscaled copies of the output image. A layer is rendered from the output
+         * image on first request after each frame, so unused layers cost nothing.
+         *
+         * @param layers sizes and scale filters of layers, empty to disable
+         *
+         * Example set_output_layers({{960, 540}, {480, 270, bnb::interfaces::scale_filter::mipmap}})
+         */
+        virtual void set_output_layers(const std::vector<output_layer>& layers) {}
+
         /**
          * Activate context for current thread
          *
@@ -82,6 +127,69 @@ namespace bnb::interfaces
          */
         virtual bnb::data_t read_current_buffer() = 0;
 
+        /**
+         * Reading RGBA bytes of the output layer for the current frame
+         *
+         * @param layer index of layer passed to set_output_layers
+         *
+         * @return a data_t with bytes of the layer, empty if there is no such layer
+         *
+         * Example read_layer(1)
+         */
+        virtual bnb::data_t read_layer(size_t layer)
+        {
+            return {};
+        }
+
+        /**
+         * Reading RGBA bytes of a region of the output image scaled to the requested size.
+         * Cropping and scaling are done on the GPU, so only width * height pixels are transferred.
+         *
+         * @param region region of the output image in the pixel coordinates of read_current_buffer,
+         * clamped to the image
+         * @param width width of the result
+         * @param height height of the result
+         *
+         * @return a data_t with width * height * 4 bytes, empty if there is no frame
+         *
+         * Example read_region({0, 0, 640, 360}, 160, 90)
+         */
+        virtual bnb::data_t read_region(const image_rect& region, int32_t width, int32_t height)
+        {
+            return {};
+        }
+
+        /**
+         * Get texture id of the output layer for the current frame
+         *
+         * @param layer index of layer passed to set_output_layers
+         *
+         * @return texture id, 0 if there is no such layer
+         *
+         * Example get_layer_texture(1)
+         */
+        virtual int get_layer_texture(size_t layer)
+        {
+            return 0;
+        }
+
+        /**
+         * Read RGBA pixels of a texture created in a context shared with the render target.
+         * Rows are returned in the order they were uploaded, so a texture filled from
+         * a CPU image gives the same image back. Called on the render thread.
+         *
+         * @param texture_id GL_TEXTURE_2D texture with RGBA color
+         * @param fence GL fence signalled when the texture is ready, may be nullptr. Waited on and deleted.
+         *
+         * @return a data_t with width * height * 4 bytes, empty if texture input is not supported
+         *
+         * Example read_texture(texture, fence, 1280, 720)
+         */
+        virtual bnb::data_t read_texture(int32_t texture_id, oep_sync fence, int32_t width, int32_t height)
+        {
+            return {};
+        }
+
         /**
          * Get texture id used for rendering of frame
          *
@@ -91,6 +199,101 @@ namespace bnb::interfaces
          */
         virtual int get_current_buffer_texture() = 0;
 
+        /**
+         * Upload an RGBA image prepared on the CPU, used for frames delivered without an effect.
+         * Each slot keeps its own texture, reallocated when the size changes. Called on the render thread.
+         *
+         * @param slot 0 for the frame, layer index + 1 for layers
+         * @param rgba width * height * 4 bytes, first row is the first row of the texture
+         *
+         * @return texture id, 0 if uploading is not supported
+         *
+         * Example upload_texture(0, data.data.get(), 1280, 720)
+         */
+        virtual int upload_texture(size_t slot, const uint8_t* rgba, int32_t width, int32_t height)
+        {
+            return 0;
+        }
+
+        /**
+         * Whether the render target has a second context shared with the rendering one,
+         * frames are read back on another thread only if it does. The rest of readback
+         * context methods are called only when it returns true.
+         */
+        virtual bool has_readback_context()
+        {
+            return false;
+        }
+
+        /**
+         * Make the readback context current for the calling thread, the readback thread
+         * keeps it current between frames.
+         *
+         * Example activate_readback_context()
+         */
+        virtual void activate_readback_context() {}
+
+        /**
+         * Release objects of the readback context. Called on the readback thread before deinit().
+         *
+         * Example deinit_readback_context()
+         */
+        virtual void deinit_readback_context() {}
+
+        /**
+         * Copy the output of the current frame to the texture of the slot and insert a fence.
+         * The texture is not touched until the slot is published again. Called on the render
+         * thread after orient_image.
+         *
+         * @param slot index of the texture in the ring
+         *
+         * Example publish_frame(1)
+         */
+        virtual published_frame publish_frame(size_t slot)
+        {
+            return {slot, 0, 0, 0, nullptr};
+        }
+
+        /**
+         * Block until the copy of the frame is done and delete its fence. Called on the readback thread.
+         *
+         * Example wait_published(frame)
+         */
+        virtual void wait_published(published_frame& frame) {}
+
+        /**
+         * Reading RGBA bytes of a region of a published frame scaled to the requested size.
+         * Called on the readback thread.
+         *
+         * @param region region of the frame, clamped to it
+         * @param filter scale filter, mipmap is read as linear
+         *
+         * @return a data_t with width * height * 4 bytes, empty if there is no frame
+         *
+         * Example read_published(frame, {0, 0, frame.width, frame.height}, 640, 360, scale_filter::linear)
+         */
+        virtual bnb::data_t read_published(const published_frame& frame, const image_rect& region,
+                                           int32_t width, int32_t height, scale_filter filter)
+        {
+            return {};
+        }
+
+        /**
+         * Scale a published frame into a texture of the readback context, used for output layers.
+         * The texture is reused by the next call with the same target. Called on the readback thread.
+         *
+         * @param target index of the texture, e.g. layer index
+         *
+         * @return texture id, 0 if there is no frame
+         *
+         * Example scale_published(frame, 0, 480, 270, scale_filter::linear)
+         */
+        virtual int scale_published(const published_frame& frame, size_t target,
+                                    int32_t width, int32_t height, scale_filter filter)
+        {
+            return 0;
+        }
+
         /**
          * get offscreen render target context to configure resource sharing
          *
@@ -2,6 +2,8 @@
 
 #include <bnb/types/full_image.hpp>
 
+#include "formats.hpp"
+
 using oep_image_ready_cb = std::function<void(std::optional<bnb::full_image_t> image)>;
 using oep_texture_cb = std::function<void(std::optional<int> texture_id)>;
 
@@ -66,6 +68,75 @@ namespace bnb::interfaces
          * Example get_texture([](std::optional<int> testure_id){})
          */
         virtual void get_texture(oep_texture_cb callback) = 0;
+
+        /**
+         * Same as get_rgba for the output layer set with offscreen_effect_player::set_output_layers.
+         * Each layer is rendered and read back independently.
+         *
+         * @param layer index of the output layer
+         * @param callback calling with full_image_t. full_image_t keep RGBA, nullopt if there is no such layer
+         *
+         * Example get_rgba_layer(1, [](std::optional<full_image_t> image){})
+         */
+        virtual void get_rgba_layer(size_t layer, oep_image_ready_cb callback) = 0;
+
+        /**
+         * Same as get_nv12 for the output layer set with offscreen_effect_player::set_output_layers.
+         *
+         * @param layer index of the output layer
+         * @param callback calling with full_image_t. full_image_t keep NV12, nullopt if there is no such layer
+         *
+         * Example get_nv12_layer(1, [](std::optional<full_image_t> image){})
+         */
+        virtual void get_nv12_layer(size_t layer, oep_image_ready_cb callback) = 0;
+
+        /**
+         * Same as get_texture for the output layer set with offscreen_effect_player::set_output_layers.
+         *
+         * @param layer index of the output layer
+         * @param callback which accepts texture id, nullopt if there is no such layer
+         *
+         * Example get_texture_layer(1, [](std::optional<int> testure_id){})
+         */
+        virtual void get_texture_layer(size_t layer, oep_texture_cb callback) = 0;
+
+        /**
+         * Get a region of the frame scaled to the requested size as RGBA. Cropping and scaling
+         * are done on the GPU before reading, so the cost depends on the requested size only.
+         *
+         * @param region region of the frame in pixels of the image returned by get_rgba
+         * @param width width of the result
+         * @param height height of the result
+         * @param callback calling with full_image_t. full_image_t keep RGBA
+         *
+         * Example get_rgba_region({0, 0, 1280, 720}, 320, 180, [](std::optional<full_image_t> image){})
+         */
+        virtual void get_rgba_region(const interfaces::image_rect& region, int32_t width, int32_t height,
+                                     oep_image_ready_cb callback) = 0;
+
+        /**
+         * Same as get_rgba_region, converted to NV12. Width and height must be even.
+         *
+         * Example get_nv12_region({0, 0, 1280, 720}, 320, 180, [](std::optional<full_image_t> image){})
+         */
+        virtual void get_nv12_region(const interfaces::image_rect& region, int32_t width, int32_t height,
+                                     oep_image_ready_cb callback) = 0;
+
+        /**
+         * Returns sequence number assigned to the frame by offscreen effect player.
+         * Matches frame ids in the trace timeline.
+         *
+         * Example get_frame_id()
+         */
+        virtual uint64_t get_frame_id() = 0;
+
+        /**
+         * Returns capture time and deadline passed with the frame. Capture time is
+         * the submission time if it wasn't passed.
+         *
+         * Example auto latency = std::chrono::steady_clock::now() - get_frame_timing().capture_time
+         */
+        virtual interfaces::frame_timing get_frame_timing() = 0;
     };
 } // bnb::interfaces
 
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "oep_ipc_protocol.hpp"
+#include "shm_frame_ring.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+namespace bnb::ipc
+{
+    class session;
+
+    /**
+     * Connection to oep_daemon, the process which owns GL contexts and effect players of a
+     * render host. Sessions of one client share the connection. Requests may be sent from
+     * any thread, they are answered in order.
+     *
+     * Example
+     *     auto client = ipc::client::connect();
+     *     auto session = client->create_session(1280, 720, "effects/Afro");
+     */
+    class client : public std::enable_shared_from_this<client>
+    {
+    public:
+        /**
+         * @return nullptr if the daemon isn't running
+         */
+        static std::shared_ptr<client> connect(const std::string& socket_path = default_socket_path);
+
+        ~client();
+
+        client(const client&) = delete;
+        client& operator=(const client&) = delete;
+
+        /**
+         * Start processing frames of the given size with an effect player of the daemon.
+         * The session is closed when the returned object is destroyed.
+         *
+         * @param effect effect loaded into the session, empty to pass frames through
+         * @param output_slots frames kept in the output ring for a slow reader
+         *
+         * @return nullptr if the daemon refused the session
+         */
+        std::unique_ptr<session> create_session(int32_t width, int32_t height, const std::string& effect,
+                                                uint32_t output_slots = 4);
+
+    private:
+        friend class session;
+
+        explicit client(int fd);
+
+        // Sends the request and waits for the reply, std::nullopt if the connection is lost
+        std::optional<message> request(const message& msg);
+        bool notify(const message& msg);
+
+        std::mutex m_mutex;
+        int m_fd;
+        uint32_t m_next_ring{0};
+    };
+
+    /**
+     * Frames are exchanged through shared memory: the client writes NV12 frames into the
+     * input ring in place and the daemon writes processed NV12 frames into the output ring.
+     * Processed frames carry capture_time_ns of their input frame.
+     *
+     * Example
+     *     auto data = session->begin_frame();
+     *     ...
+     *     session->submit_frame(capture_time_ns);
+     *     if (session->wait_output(std::chrono::milliseconds(100))) {
+     *         session->read_output([](const shm::frame_info& info, const uint8_t* nv12) { ... });
+     *     }
+     */
+    class session
+    {
+    public:
+        ~session();
+
+        session(const session&) = delete;
+        session& operator=(const session&) = delete;
+
+        int32_t width() const
+        {
+            return m_width;
+        }
+
+        int32_t height() const
+        {
+            return m_height;
+        }
+
+        /**
+         * @return width * height * 3 / 2 bytes for the next NV12 frame, Y plane followed by UV plane
+         */
+        uint8_t* begin_frame();
+
+        /**
+         * Publish the frame written since begin_frame and wake the daemon up
+         *
+         * @param capture_time_ns steady clock time of the frame capture, used for deadlines and latency
+         *
+         * @return false if the connection to the daemon is lost
+         */
+        bool submit_frame(int64_t capture_time_ns);
+
+        /**
+         * Load effect async, empty path to pass frames through
+         *
+         * @return false if the daemon can't load it
+         */
+        bool load_effect(const std::string& effect);
+
+        /**
+         * Wait for a processed frame newer than the last one read.
+         *
+         * @return false on timeout
+         */
+        bool wait_output(std::chrono::microseconds timeout);
+
+        /**
+         * Pass the latest processed frame to f without copying, see shm::frame_reader::read_latest
+         */
+        bool read_output(const std::function<void(const shm::frame_info& info, const uint8_t* data)>& f);
+
+        // Processed frames overwritten before they were read
+        uint64_t outputs_missed() const;
+
+    private:
+        friend class client;
+
+        session(std::shared_ptr<client> owner, uint32_t id, int32_t width, int32_t height,
+                std::unique_ptr<shm::frame_writer> input, std::unique_ptr<shm::frame_reader> output);
+
+        std::shared_ptr<client> m_client;
+        uint32_t m_id;
+        int32_t m_width;
+        int32_t m_height;
+        uint64_t m_next_frame_id{0};
+        std::unique_ptr<shm::frame_writer> m_input;
+        std::unique_ptr<shm::frame_reader> m_output;
+    };
+} // bnb::ipc
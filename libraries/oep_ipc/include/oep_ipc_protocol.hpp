@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace bnb::ipc
+{
+    // Bumped on any change of the message layout, the daemon rejects other versions
+    constexpr uint32_t protocol_version = 1;
+    constexpr char default_socket_path[] = "/tmp/oep_daemon.sock";
+    constexpr size_t max_text = 256;
+
+    enum class message_type : uint32_t
+    {
+        // Client requests, answered with reply
+        create_session,
+        destroy_session,
+        load_effect,
+        // A new frame was committed to the input ring of the session, not answered
+        frame_ready,
+        // Daemon answer to the last request
+        reply,
+    };
+
+    enum class status : int32_t
+    {
+        ok,
+        bad_request,
+        version_mismatch,
+        no_session,
+        session_limit,
+        failed,
+    };
+
+    /**
+     * Every message is sent as one SOCK_SEQPACKET packet of this size. Frames don't go through
+     * the socket: a session has an input ring created by the client and an output ring created
+     * by the daemon (see shm_frame_ring), frame_ready only wakes the daemon up.
+     *
+     * create_session: width and height of frames, slots of the output ring, text is the input ring name.
+     *     Reply: session id, text is the output ring name
+     * destroy_session: session
+     * load_effect: session, text is the effect path, empty to unload
+     * frame_ready: session
+     */
+    struct message
+    {
+        uint32_t version{protocol_version};
+        message_type type{message_type::reply};
+        status result{status::ok};
+        uint32_t session{0};
+        int32_t width{0};
+        int32_t height{0};
+        uint32_t slots{0};
+        char text[max_text]{};
+
+        void set_text(const std::string& value);
+        std::string get_text() const;
+    };
+
+    /**
+     * Create a listening Unix domain socket, replacing a stale socket file. The socket file
+     * is accessible to the owner only, or to the owner and the group when one is given.
+     *
+     * @return socket fd, -1 on failure
+     */
+    int listen_socket(const std::string& path, const std::string& group = {});
+
+    /**
+     * @return socket fd, -1 on failure
+     */
+    int connect_socket(const std::string& path);
+
+    /**
+     * User id of the process on the other end of a connected socket.
+     */
+    std::optional<uint32_t> peer_uid(int fd);
+
+    /**
+     * @param blocking false to fail instead of waiting when the socket buffer is full,
+     * e.g. because the peer stopped reading
+     */
+    bool send_message(int fd, const message& msg, bool blocking = true);
+
+    /**
+     * @return std::nullopt when the peer disconnected or sent a malformed packet
+     */
+    std::optional<message> receive_message(int fd);
+} // bnb::ipc
@@ -0,0 +1,150 @@
+#include "oep_ipc_client.hpp"
+
+#include <unistd.h>
+
+namespace
+{
+    // Daemon renders the latest input frame, a couple of slots let the client write the next one meanwhile
+    constexpr uint32_t input_slots = 3;
+} // namespace
+
+namespace bnb::ipc
+{
+    std::shared_ptr<client> client::connect(const std::string& socket_path)
+    {
+        int fd = connect_socket(socket_path);
+        if (fd < 0) {
+            return nullptr;
+        }
+        // we use "new" instead of "make_shared" because the constructor is private
+        return std::shared_ptr<client>(new client(fd));
+    }
+
+    client::client(int fd)
+        : m_fd(fd) {}
+
+    client::~client()
+    {
+        // The daemon closes sessions of the connection which are still open
+        close(m_fd);
+    }
+
+    std::unique_ptr<session> client::create_session(int32_t width, int32_t height, const std::string& effect,
+                                                    uint32_t output_slots)
+    {
+        if (width <= 0 || height <= 0 || width % 2 != 0 || height % 2 != 0) {
+            return nullptr;
+        }
+
+        std::string input_name;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            input_name = "/oep_client_" + std::to_string(getpid()) + "_" + std::to_string(m_next_ring++);
+        }
+        auto input = shm::frame_writer::create(input_name, input_slots, uint32_t(width) * uint32_t(height) * 3 / 2);
+        if (input == nullptr) {
+            return nullptr;
+        }
+
+        message msg;
+        msg.type = message_type::create_session;
+        msg.width = width;
+        msg.height = height;
+        msg.slots = output_slots;
+        msg.set_text(input_name);
+        auto reply = request(msg);
+        if (!reply.has_value() || reply->result != status::ok) {
+            return nullptr;
+        }
+
+        auto output = shm::frame_reader::open(reply->get_text());
+        std::unique_ptr<session> result(new session(shared_from_this(), reply->session, width, height,
+            std::move(input), std::move(output)));
+        if (result->m_output == nullptr || (!effect.empty() && !result->load_effect(effect))) {
+            return nullptr;
+        }
+        return result;
+    }
+
+    std::optional<message> client::request(const message& msg)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!send_message(m_fd, msg)) {
+            return std::nullopt;
+        }
+        auto reply = receive_message(m_fd);
+        if (!reply.has_value() || reply->type != message_type::reply) {
+            return std::nullopt;
+        }
+        return reply;
+    }
+
+    bool client::notify(const message& msg)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return send_message(m_fd, msg);
+    }
+
+    session::session(std::shared_ptr<client> owner, uint32_t id, int32_t width, int32_t height,
+                     std::unique_ptr<shm::frame_writer> input, std::unique_ptr<shm::frame_reader> output)
+        : m_client(std::move(owner))
+        , m_id(id)
+        , m_width(width)
+        , m_height(height)
+        , m_input(std::move(input))
+        , m_output(std::move(output)) {}
+
+    session::~session()
+    {
+        message msg;
+        msg.type = message_type::destroy_session;
+        msg.session = m_id;
+        m_client->request(msg);
+    }
+
+    uint8_t* session::begin_frame()
+    {
+        return m_input->begin_frame();
+    }
+
+    bool session::submit_frame(int64_t capture_time_ns)
+    {
+        shm::frame_info info{};
+        info.frame_id = ++m_next_frame_id;
+        info.width = m_width;
+        info.height = m_height;
+        info.size = m_input->slot_size();
+        info.capture_time_ns = capture_time_ns;
+        m_input->commit_frame(info);
+
+        message msg;
+        msg.type = message_type::frame_ready;
+        msg.session = m_id;
+        return m_client->notify(msg);
+    }
+
+    bool session::load_effect(const std::string& effect)
+    {
+        message msg;
+        msg.type = message_type::load_effect;
+        msg.session = m_id;
+        msg.set_text(effect);
+        auto reply = m_client->request(msg);
+        return reply.has_value() && reply->result == status::ok;
+    }
+
+    bool session::wait_output(std::chrono::microseconds timeout)
+    {
+        return m_output->wait(timeout);
+    }
+
+    bool session::read_output(const std::function<void(const shm::frame_info& info, const uint8_t* data)>& f)
+    {
+        return m_output->read_latest(f);
+    }
+
+    uint64_t session::outputs_missed() const
+    {
+        return m_output->frames_missed();
+    }
+} // bnb::ipc
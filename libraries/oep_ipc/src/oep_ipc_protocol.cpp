@@ -0,0 +1,139 @@
+#include "oep_ipc_protocol.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <grp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    bool make_address(const std::string& path, sockaddr_un& address)
+    {
+        address = {};
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+} // namespace
+
+namespace bnb::ipc
+{
+    void message::set_text(const std::string& value)
+    {
+        auto size = std::min(value.size(), max_text - 1);
+        std::memcpy(text, value.data(), size);
+        text[size] = '\0';
+    }
+
+    std::string message::get_text() const
+    {
+        return std::string(text, strnlen(text, max_text));
+    }
+
+    int listen_socket(const std::string& path, const std::string& group)
+    {
+        sockaddr_un address;
+        if (!make_address(path, address)) {
+            return -1;
+        }
+
+        gid_t gid = gid_t(-1);
+        if (!group.empty()) {
+            auto entry = getgrnam(group.c_str());
+            if (entry == nullptr) {
+                return -1;
+            }
+            gid = entry->gr_gid;
+        }
+
+        // SOCK_SEQPACKET keeps message boundaries, a message is never split or merged
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        unlink(path.c_str());
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        // Nobody can connect before listen(), so the permissions are in place for the first client
+        bool restricted = group.empty()
+            ? chmod(path.c_str(), 0600) == 0
+            : chown(path.c_str(), uid_t(-1), gid) == 0 && chmod(path.c_str(), 0660) == 0;
+        if (!restricted || listen(fd, SOMAXCONN) != 0) {
+            close(fd);
+            unlink(path.c_str());
+            return -1;
+        }
+        return fd;
+    }
+
+    int connect_socket(const std::string& path)
+    {
+        sockaddr_un address;
+        if (!make_address(path, address)) {
+            return -1;
+        }
+
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    std::optional<uint32_t> peer_uid(int fd)
+    {
+#ifdef SO_PEERCRED
+        ucred credentials{};
+        socklen_t size = sizeof(credentials);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0) {
+            return std::nullopt;
+        }
+        return uint32_t(credentials.uid);
+#else
+        uid_t uid;
+        gid_t gid;
+        if (getpeereid(fd, &uid, &gid) != 0) {
+            return std::nullopt;
+        }
+        return uint32_t(uid);
+#endif
+    }
+
+    bool send_message(int fd, const message& msg, bool blocking)
+    {
+        ssize_t sent;
+        do {
+            // A peer that went away is reported by the return value instead of SIGPIPE
+            sent = send(fd, &msg, sizeof(msg), MSG_NOSIGNAL | (blocking ? 0 : MSG_DONTWAIT));
+        } while (sent < 0 && errno == EINTR);
+        return sent == ssize_t(sizeof(msg));
+    }
+
+    std::optional<message> receive_message(int fd)
+    {
+        message msg;
+        ssize_t received;
+        do {
+            received = recv(fd, &msg, sizeof(msg), 0);
+        } while (received < 0 && errno == EINTR);
+        if (received != ssize_t(sizeof(msg))) {
+            return std::nullopt;
+        }
+        msg.text[max_text - 1] = '\0';
+        return msg;
+    }
+} // bnb::ipc
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace bnb::render
+{
+    struct frame_handle
+    {
+        int texture_id{0};
+        GLsync fence{nullptr};
+        uint64_t frame_id{0};
+    };
+
+    /**
+     * Lock-free triple buffer of frame handles between single producer and single consumer.
+     * Producer never blocks, consumer always gets the newest published frame.
+     * Fences of frames overwritten before the consumer took them are deleted by producer,
+     * so both threads must have contexts from the same share group current.
+     */
+    class frame_mailbox
+    {
+    public:
+        frame_mailbox() = default;
+        ~frame_mailbox() = default;
+
+        frame_mailbox(const frame_mailbox&) = delete;
+        frame_mailbox& operator=(const frame_mailbox&) = delete;
+
+        /**
+         * Producer side.
+         */
+        void publish(const frame_handle& frame);
+
+        /**
+         * Consumer side. Returns newest frame published since previous call or nullptr.
+         * Returned handle stays valid until the next call, consumer owns its fence.
+         */
+        frame_handle* acquire();
+
+        /**
+         * Delete all fences. Call when both sides are stopped.
+         */
+        void reset();
+
+        uint64_t skipped_frames() const
+        {
+            return m_skipped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static constexpr uint8_t index_mask = 0x3;
+        static constexpr uint8_t fresh_bit = 0x4;
+
+        std::array<frame_handle, 3> m_slots{};
+
+        // Index of the middle slot and the flag that it holds unconsumed frame
+        std::atomic<uint8_t> m_middle{0};
+        uint8_t m_back{1};  // owned by producer
+        uint8_t m_front{2}; // owned by consumer
+
+        std::atomic<uint64_t> m_skipped{0};
+    };
+} // bnb::render
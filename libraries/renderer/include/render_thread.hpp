@@ -4,28 +4,54 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 
 #include "renderer.hpp"
 
 namespace bnb::render
 {
+    enum class present_mode
+    {
+        vsync,       // swap interval 1, presentation blocks until vertical blank
+        mailbox,     // swap interval 0, newest frame presented at most once per display refresh
+        unthrottled, // swap interval 0, every frame presented immediately (benchmarking)
+    };
+
     class render_thread
     {
     public:
-        render_thread(GLFWwindow* window, int32_t width, int32_t height);
+        render_thread(GLFWwindow* window, int32_t width, int32_t height, present_mode mode = present_mode::vsync);
 
         ~render_thread();
 
         void surface_changed(int32_t width, int32_t height);
-        void update_data(int texture_id);
+        void update_data(int texture_id, uint64_t frame_id = 0);
+
+        void set_present_mode(present_mode mode);
+
+        // Frames replaced by newer ones before they were presented
+        uint64_t skipped_frames() const;
 
     private:
         void thread_func(int32_t width, int32_t height);
+        void apply_present_mode();
 
         std::unique_ptr<renderer> m_renderer { nullptr };
         GLFWwindow* m_window;
+
+        std::atomic<present_mode> m_present_mode;
+        present_mode m_applied_present_mode;
+        std::chrono::steady_clock::duration m_refresh_period;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_frame_pending { false };
+        std::atomic<bool> m_cancellation_flag { false };
+
+        // Must be the last member, the thread uses all above
         std::thread m_thread;
-        std::atomic<bool> m_cancellation_flag;
     };
 } // bnb::render
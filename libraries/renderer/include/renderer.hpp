@@ -4,6 +4,7 @@
 
 #include "program.hpp"
 #include "frame_surface_handler.hpp"
+#include "frame_mailbox.hpp"
 
 namespace bnb::render
 {
@@ -17,22 +18,31 @@ namespace bnb::render
     {
     public:
         renderer(int width, int height);
+        ~renderer();
 
         void surface_change(int32_t width, int32_t height);
 
-        void update_data(int texture_id);
+        /**
+         * Publish texture for presentation, never blocks. If the calling thread has
+         * a current GL context (shared with the renderer one) a fence is inserted,
+         * so the texture is sampled only after producer commands complete.
+         */
+        void update_data(int texture_id, uint64_t frame_id = 0);
         bool draw();
 
+        uint64_t skipped_frames() const
+        {
+            return m_mailbox.skipped_frames();
+        }
+
     private:
         program m_program;
         frame_surface_handler m_frame_surface;
 
         int m_width;
         int m_height;
-        int m_texture_id{ 0 };
 
-        std::atomic<bool> m_rendering = false;
-        std::atomic<bool> m_texture_updated = false;
+        frame_mailbox m_mailbox;
 
         std::atomic<bool> m_surface_changed = false;
     };
@@ -0,0 +1,46 @@
+#include "frame_mailbox.hpp"
+
+namespace bnb::render
+{
+    void frame_mailbox::publish(const frame_handle& frame)
+    {
+        m_slots[m_back] = frame;
+
+        auto previous = m_middle.exchange(static_cast<uint8_t>(m_back | fresh_bit), std::memory_order_acq_rel);
+        m_back = previous & index_mask;
+
+        if (previous & fresh_bit) {
+            // Consumer didn't take the frame, it will never be presented
+            m_skipped.fetch_add(1, std::memory_order_relaxed);
+            auto& skipped = m_slots[m_back];
+            if (skipped.fence != nullptr) {
+                glDeleteSync(skipped.fence);
+                skipped.fence = nullptr;
+            }
+        }
+    }
+
+    frame_handle* frame_mailbox::acquire()
+    {
+        if ((m_middle.load(std::memory_order_acquire) & fresh_bit) == 0) {
+            return nullptr;
+        }
+
+        auto previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & index_mask;
+        return &m_slots[m_front];
+    }
+
+    void frame_mailbox::reset()
+    {
+        for (auto& slot : m_slots) {
+            if (slot.fence != nullptr) {
+                glDeleteSync(slot.fence);
+                slot.fence = nullptr;
+            }
+        }
+        m_middle = 0;
+        m_back = 1;
+        m_front = 2;
+    }
+} // bnb::render
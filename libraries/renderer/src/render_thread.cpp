@@ -1,17 +1,34 @@
 #include "render_thread.hpp"
 
+#include "tracer.hpp"
+
 #include <libyuv.h>
 
 namespace bnb::render
 {
-    render_thread::render_thread(GLFWwindow* window, int32_t width, int32_t height)
+    render_thread::render_thread(GLFWwindow* window, int32_t width, int32_t height, present_mode mode)
         : m_window(window)
-        , m_thread([this, width, height]() { thread_func(width, height); })
-        , m_cancellation_flag(false) {}
+        , m_present_mode(mode)
+        , m_applied_present_mode(mode)
+        , m_refresh_period(std::chrono::microseconds(16667))
+    {
+        // Monitor queries are allowed only on the main thread
+        if (auto monitor = glfwGetPrimaryMonitor()) {
+            if (auto video_mode = glfwGetVideoMode(monitor); video_mode && video_mode->refreshRate > 0) {
+                m_refresh_period = std::chrono::microseconds(1000000 / video_mode->refreshRate);
+            }
+        }
+
+        m_thread = std::thread([this, width, height]() { thread_func(width, height); });
+    }
 
     render_thread::~render_thread()
     {
-        m_cancellation_flag = true;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cancellation_flag = true;
+        }
+        m_cv.notify_one();
         m_thread.join();
     }
 
@@ -22,29 +39,76 @@ namespace bnb::render
         }
     }
 
-    void render_thread::update_data(int texture_id)
+    void render_thread::update_data(int texture_id, uint64_t frame_id)
+    {
+        if (!m_renderer) {
+            return;
+        }
+
+        m_renderer->update_data(texture_id, frame_id);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_frame_pending = true;
+        }
+        m_cv.notify_one();
+    }
+
+    void render_thread::set_present_mode(present_mode mode)
+    {
+        m_present_mode = mode;
+    }
+
+    uint64_t render_thread::skipped_frames() const
+    {
+        return m_renderer ? m_renderer->skipped_frames() : 0;
+    }
+
+    void render_thread::apply_present_mode()
     {
-        if (m_renderer)
-            m_renderer->update_data(texture_id);
+        m_applied_present_mode = m_present_mode;
+        glfwSwapInterval(m_applied_present_mode == present_mode::vsync ? 1 : 0);
     }
 
     void render_thread::thread_func(int32_t width, int32_t height)
     {
-        using namespace std::chrono_literals;
+        BNB_TRACE_THREAD_NAME("preview_render");
 
         glfwMakeContextCurrent(m_window);
-        glfwSwapInterval(1);
+        apply_present_mode();
 
         m_renderer = std::make_unique<renderer>(width, height);
 
-        while (!m_cancellation_flag) {
+        auto next_present = std::chrono::steady_clock::now();
+        for (;;) {
+            {
+                // Sleep until a new frame arrives, no polling while idle
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return m_cancellation_flag || m_frame_pending; });
+                if (m_cancellation_flag) {
+                    break;
+                }
+                m_frame_pending = false;
+
+                if (m_applied_present_mode == present_mode::mailbox) {
+                    // Frames arriving before the next refresh replace the pending one
+                    m_cv.wait_until(lock, next_present, [this]() { return m_cancellation_flag.load(); });
+                    if (m_cancellation_flag) {
+                        break;
+                    }
+                    m_frame_pending = false;
+                }
+            }
+
+            if (m_present_mode != m_applied_present_mode) {
+                apply_present_mode();
+            }
+
             if (m_renderer->draw()) {
                 glfwSwapBuffers(m_window);
-            } else {
-                std::this_thread::sleep_for(1us);
+                next_present = std::chrono::steady_clock::now() + m_refresh_period;
             }
         }
         m_renderer.reset();
         glfwMakeContextCurrent(nullptr);
     }
-} // bnb::render
\ No newline at end of file
+} // bnb::render
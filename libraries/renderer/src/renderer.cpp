@@ -1,5 +1,9 @@
 #include "renderer.hpp"
 #include "opengl.hpp"
+#include "tracer.hpp"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
 
 //NV12
 namespace
@@ -35,6 +39,11 @@ namespace bnb::render
         surface_change(width, height);
     }
 
+    renderer::~renderer()
+    {
+        m_mailbox.reset();
+    }
+
     void renderer::surface_change(int32_t width, int32_t height)
     {
         m_width = width;
@@ -42,43 +51,48 @@ namespace bnb::render
         m_surface_changed = true;
     }
 
-    void renderer::update_data(int texture_id)
+    void renderer::update_data(int texture_id, uint64_t frame_id)
     {
-        if (m_texture_updated && m_rendering) {
-            return;
+        GLsync fence = nullptr;
+        if (glfwGetCurrentContext() != nullptr) {
+            fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            // Fence must reach the GPU before another context waits on it
+            glFlush();
         }
 
-        m_texture_updated = false;
-        m_texture_id = texture_id;
-        m_texture_updated = true;
+        m_mailbox.publish({texture_id, fence, frame_id});
     }
 
     bool renderer::draw()
     {
-        if (!m_texture_updated) {
+        auto frame = m_mailbox.acquire();
+        if (frame == nullptr) {
             return false;
         }
 
+        if (frame->fence != nullptr) {
+            GL_CALL(glWaitSync(frame->fence, 0, GL_TIMEOUT_IGNORED));
+            GL_CALL(glDeleteSync(frame->fence));
+            frame->fence = nullptr;
+        }
+
         if (m_surface_changed) {
             GL_CALL(glViewport(0, 0, m_width, m_height));
             m_surface_changed = false;
         }
 
-        m_rendering = true;
-
-        m_texture_updated = false;
+        BNB_TRACE_SCOPE("preview_draw", frame->frame_id);
 
         m_program.use();
 
         GL_CALL(glActiveTexture(GLenum(GL_TEXTURE0)));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, m_texture_id));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, frame->texture_id));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
 
         m_frame_surface.draw();
 
         m_program.unuse();
-        m_rendering = false;
 
         return true;
     }
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace bnb::shm
+{
+    /**
+     * Frame stored in a slot of the ring
+     */
+    struct frame_info
+    {
+        // Sequential number of the frame in the ring, set by the writer
+        uint64_t index;
+        uint64_t frame_id;
+        // NV12, Y plane followed by interleaved UV plane, both with stride equal to the width
+        int32_t width;
+        int32_t height;
+        uint32_t size;
+        // Steady clock (CLOCK_MONOTONIC), comparable between processes of one machine
+        int64_t capture_time_ns;
+        // Set by the writer on commit
+        int64_t publish_time_ns;
+    };
+
+    /**
+     * Writing side of a POSIX shared memory ring of frames, for consumers in other processes.
+     * Frames are written in place, the writer never waits for readers: a slot being read
+     * may be overwritten, readers detect it by the slot sequence number (seqlock).
+     *
+     * Layout: header with "BNBSHM01" magic, slot count, slot size and the number of committed
+     * frames, then slots on 4 KB boundaries. A slot starts with a sequence number, odd while
+     * the slot is written, and frame_info, followed by frame data. Readers sleep on a futex
+     * in the header on Linux and poll on other systems. The library is built on Unix only.
+     *
+     * Example
+     *     auto writer = shm::frame_writer::create("/oep_frames", 4, 1280 * 720 * 3 / 2);
+     *     auto data = writer->begin_frame();
+     *     ...
+     *     writer->commit_frame(info);
+     */
+    class frame_writer
+    {
+    public:
+        /**
+         * Create the ring, replacing a stale one with the same name. The name is unlinked
+         * when the writer is destroyed, opened readers keep their mapping.
+         *
+         * @return nullptr if shared memory can't be created
+         */
+        static std::unique_ptr<frame_writer> create(const std::string& name, uint32_t slot_count, uint32_t slot_size);
+
+        ~frame_writer();
+
+        frame_writer(const frame_writer&) = delete;
+        frame_writer& operator=(const frame_writer&) = delete;
+
+        uint32_t slot_size() const
+        {
+            return m_slot_size;
+        }
+
+        /**
+         * Start writing the next slot. Frames are written one at a time.
+         *
+         * @return slot_size bytes of the slot
+         */
+        uint8_t* begin_frame();
+
+        /**
+         * Publish the frame written since begin_frame and wake readers
+         */
+        void commit_frame(const frame_info& info);
+
+        /**
+         * Make the slot of begin_frame available again without publishing it
+         */
+        void abort_frame();
+
+    private:
+        frame_writer() = default;
+
+        std::string m_name;
+        uint8_t* m_memory = nullptr;
+        size_t m_size = 0;
+        uint32_t m_slot_size = 0;
+        uint32_t m_slot_count = 0;
+        size_t m_slot_stride = 0;
+        uint8_t* m_slot = nullptr;
+    };
+
+    /**
+     * Reading side of the ring, see frame_writer. Frames are passed to the caller in place.
+     *
+     * Example
+     *     auto reader = shm::frame_reader::open("/oep_frames");
+     *     while (reader->wait(std::chrono::milliseconds(100))) {
+     *         reader->read_latest([](const shm::frame_info& info, const uint8_t* nv12) { ... });
+     *     }
+     */
+    class frame_reader
+    {
+    public:
+        /**
+         * @return nullptr if the ring doesn't exist or isn't valid
+         */
+        static std::unique_ptr<frame_reader> open(const std::string& name);
+
+        ~frame_reader();
+
+        frame_reader(const frame_reader&) = delete;
+        frame_reader& operator=(const frame_reader&) = delete;
+
+        /**
+         * Wait for a frame newer than the last one read.
+         *
+         * @return false on timeout
+         */
+        bool wait(std::chrono::microseconds timeout);
+
+        /**
+         * Pass the latest frame to f without copying, f must not keep the pointer.
+         *
+         * @return false if there is no new frame, or the writer overwrote the slot while
+         * f was running, anything f got from the data must be discarded then
+         */
+        bool read_latest(const std::function<void(const frame_info& info, const uint8_t* data)>& f);
+
+        // Frames overwritten before they were read, and reads spoiled by the writer
+        uint64_t frames_missed() const
+        {
+            return m_missed;
+        }
+
+        uint64_t reads_torn() const
+        {
+            return m_torn;
+        }
+
+        // Largest frame a slot holds, as validated by open
+        uint32_t slot_size() const
+        {
+            return m_slot_size;
+        }
+
+        // User id owning the shared memory when it was opened, lets a server check who created the ring
+        uint32_t owner() const
+        {
+            return m_owner;
+        }
+
+    private:
+        frame_reader() = default;
+
+        uint8_t* m_memory = nullptr;
+        size_t m_size = 0;
+        uint32_t m_slot_count = 0;
+        uint32_t m_slot_size = 0;
+        size_t m_slot_stride = 0;
+        uint32_t m_owner = 0;
+        uint64_t m_next = 0;
+        uint64_t m_missed = 0;
+        uint64_t m_torn = 0;
+    };
+} // bnb::shm
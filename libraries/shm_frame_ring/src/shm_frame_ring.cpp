@@ -0,0 +1,310 @@
+#include "shm_frame_ring.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+    #include <climits>
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+#endif
+
+namespace
+{
+    constexpr char magic[8] = {'B', 'N', 'B', 'S', 'H', 'M', '0', '1'};
+    constexpr size_t page = 4096;
+    // Frame data starts on its own cache lines after the slot header
+    constexpr size_t data_offset = 128;
+    // Readers without futex check for new frames this often
+    constexpr std::chrono::microseconds poll_interval{500};
+
+    // Placed at the beginning of the shared memory, followed by slots starting at page offset
+    struct ring_header
+    {
+        char magic[8];
+        uint32_t slot_count;
+        uint32_t slot_size;
+        uint64_t slot_stride;
+        // Frames committed so far, the latest one is in slot (committed - 1) % slot_count
+        std::atomic<uint64_t> committed;
+        // Futex word, changes on every commit
+        std::atomic<uint32_t> notify;
+        // Readers sleeping on the futex, the writer doesn't make the wake syscall without them
+        std::atomic<uint32_t> waiters;
+    };
+
+    struct slot_header
+    {
+        // Odd while the writer fills the slot
+        std::atomic<uint64_t> sequence;
+        bnb::shm::frame_info info;
+    };
+
+    // The ring is shared between processes, atomics must not fall back to locks
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "64-bit atomics must be lock-free");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "32-bit atomics must be lock-free");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32-bit");
+    static_assert(sizeof(ring_header) <= page, "ring header must fit the first page");
+    static_assert(sizeof(slot_header) <= data_offset, "slot header must fit before frame data");
+
+    size_t align(size_t value)
+    {
+        return (value + page - 1) / page * page;
+    }
+
+    ring_header* header_of(uint8_t* memory)
+    {
+        return reinterpret_cast<ring_header*>(memory);
+    }
+
+    // Geometry is passed from the local copy, the header may be rewritten by the other process
+    slot_header* slot_of(uint8_t* memory, uint64_t index, uint32_t slot_count, size_t slot_stride)
+    {
+        return reinterpret_cast<slot_header*>(memory + page + (index % slot_count) * slot_stride);
+    }
+
+    int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void wake_readers(ring_header* header)
+    {
+#ifdef __linux__
+        // Not FUTEX_PRIVATE_FLAG, readers are in other processes
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header->notify), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+        (void) header;
+#endif
+    }
+} // namespace
+
+namespace bnb::shm
+{
+    std::unique_ptr<frame_writer> frame_writer::create(const std::string& name, uint32_t slot_count, uint32_t slot_size)
+    {
+        if (slot_count == 0 || slot_size == 0) {
+            return nullptr;
+        }
+
+        // A ring left by a writer that crashed is replaced, readers of it see no new frames
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            return nullptr;
+        }
+
+        auto slot_stride = align(data_offset + slot_size);
+        auto size = page + slot_stride * slot_count;
+        if (ftruncate(fd, off_t(size)) != 0) {
+            close(fd);
+            shm_unlink(name.c_str());
+            return nullptr;
+        }
+        auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED) {
+            shm_unlink(name.c_str());
+            return nullptr;
+        }
+
+        std::unique_ptr<frame_writer> writer(new frame_writer());
+        writer->m_name = name;
+        writer->m_memory = static_cast<uint8_t*>(memory);
+        writer->m_size = size;
+        writer->m_slot_size = slot_size;
+        writer->m_slot_count = slot_count;
+        writer->m_slot_stride = slot_stride;
+
+        // Memory is zero filled, atomics are constructed in place
+        auto header = new (memory) ring_header{};
+        header->slot_count = slot_count;
+        header->slot_size = slot_size;
+        header->slot_stride = slot_stride;
+        for (uint32_t i = 0; i < slot_count; ++i) {
+            new (slot_of(writer->m_memory, i, slot_count, slot_stride)) slot_header{};
+        }
+        // Readers check the magic first, it is written after everything else
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(header->magic, magic, sizeof(magic));
+        return writer;
+    }
+
+    frame_writer::~frame_writer()
+    {
+        munmap(m_memory, m_size);
+        shm_unlink(m_name.c_str());
+    }
+
+    uint8_t* frame_writer::begin_frame()
+    {
+        auto header = header_of(m_memory);
+        m_slot = reinterpret_cast<uint8_t*>(
+            slot_of(m_memory, header->committed.load(std::memory_order_relaxed), m_slot_count, m_slot_stride));
+
+        auto slot = reinterpret_cast<slot_header*>(m_slot);
+        slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        // Readers which see the new data also see the odd sequence
+        std::atomic_thread_fence(std::memory_order_release);
+        return m_slot + data_offset;
+    }
+
+    void frame_writer::commit_frame(const frame_info& info)
+    {
+        if (m_slot == nullptr) {
+            return;
+        }
+
+        auto header = header_of(m_memory);
+        auto slot = reinterpret_cast<slot_header*>(m_slot);
+        auto index = header->committed.load(std::memory_order_relaxed);
+        slot->info = info;
+        slot->info.index = index;
+        slot->info.size = std::min(info.size, m_slot_size);
+        slot->info.publish_time_ns = now_ns();
+        slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        m_slot = nullptr;
+
+        header->committed.store(index + 1, std::memory_order_release);
+        // Sequentially consistent with the waiters increment of a reader, see frame_reader::wait
+        header->notify.fetch_add(1);
+        if (header->waiters.load() > 0) {
+            wake_readers(header);
+        }
+    }
+
+    void frame_writer::abort_frame()
+    {
+        if (m_slot == nullptr) {
+            return;
+        }
+
+        // Readers which started before begin_frame see a changed sequence and discard the read
+        auto slot = reinterpret_cast<slot_header*>(m_slot);
+        slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        m_slot = nullptr;
+    }
+
+    std::unique_ptr<frame_reader> frame_reader::open(const std::string& name)
+    {
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < page) {
+            close(fd);
+            return nullptr;
+        }
+        auto size = size_t(st.st_size);
+        auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED) {
+            return nullptr;
+        }
+
+        std::unique_ptr<frame_reader> reader(new frame_reader());
+        reader->m_memory = static_cast<uint8_t*>(memory);
+        reader->m_size = size;
+        reader->m_owner = uint32_t(st.st_uid);
+
+        auto header = header_of(reader->m_memory);
+        if (std::memcmp(header->magic, magic, sizeof(magic)) != 0) {
+            return nullptr;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Validated once and kept, later changes of the header by the writer process are ignored
+        reader->m_slot_count = header->slot_count;
+        reader->m_slot_size = header->slot_size;
+        reader->m_slot_stride = size_t(header->slot_stride);
+        if (reader->m_slot_count == 0 || reader->m_slot_stride < data_offset + reader->m_slot_size
+            || (size - page) / reader->m_slot_stride < reader->m_slot_count) {
+            return nullptr;
+        }
+
+        // The latest frame already in the ring is the first one to read
+        auto committed = header->committed.load(std::memory_order_acquire);
+        reader->m_next = committed > 0 ? committed - 1 : 0;
+        return reader;
+    }
+
+    frame_reader::~frame_reader()
+    {
+        munmap(m_memory, m_size);
+    }
+
+    bool frame_reader::wait(std::chrono::microseconds timeout)
+    {
+        auto header = header_of(m_memory);
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (;;) {
+            // Loaded before the check, a commit after it changes the futex word and the wait returns at once
+            auto notify = header->notify.load(std::memory_order_acquire);
+            if (header->committed.load(std::memory_order_acquire) > m_next) {
+                return true;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                return false;
+            }
+            auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+
+#ifdef __linux__
+            timespec ts{};
+            ts.tv_sec = time_t(remaining.count() / 1000000000);
+            ts.tv_nsec = long(remaining.count() % 1000000000);
+            header->waiters.fetch_add(1);
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header->notify), FUTEX_WAIT, notify, &ts, nullptr, 0);
+            header->waiters.fetch_sub(1);
+#else
+            (void) notify;
+            std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(remaining, poll_interval));
+#endif
+        }
+    }
+
+    bool frame_reader::read_latest(const std::function<void(const frame_info& info, const uint8_t* data)>& f)
+    {
+        auto header = header_of(m_memory);
+        auto committed = header->committed.load(std::memory_order_acquire);
+        if (committed == 0 || committed - 1 < m_next) {
+            return false;
+        }
+
+        auto slot = slot_of(m_memory, committed - 1, m_slot_count, m_slot_stride);
+        auto sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence % 2 != 0) {
+            // Already being overwritten by a newer frame
+            ++m_torn;
+            return false;
+        }
+
+        frame_info info;
+        std::memcpy(&info, &slot->info, sizeof(info));
+        if (info.index < m_next || info.size > m_slot_size) {
+            return false;
+        }
+        f(info, reinterpret_cast<const uint8_t*>(slot) + data_offset);
+
+        // Reads of the data above are ordered before the sequence check
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) != sequence) {
+            ++m_torn;
+            return false;
+        }
+
+        m_missed += info.index - m_next;
+        m_next = info.index + 1;
+        return true;
+    }
+} // bnb::shm
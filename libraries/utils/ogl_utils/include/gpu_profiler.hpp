@@ -0,0 +1,141 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace bnb::gl
+{
+    /**
+     * Per-context GPU/CPU stage timer. Every named stage keeps a small ring of
+     * GL_TIMESTAMP query pairs, results are collected only when already available,
+     * so profiling never stalls the pipeline. Results lag a few frames behind.
+     * Must be used only on the thread where the owning context is current.
+     */
+    class gpu_profiler
+    {
+    public:
+        struct stage_stats
+        {
+            std::string name;
+            uint64_t samples{0};
+            double cpu_ms_avg{0.0};
+            double gpu_ms_avg{0.0};
+            double cpu_ms_last{0.0};
+            double gpu_ms_last{0.0};
+        };
+
+        gpu_profiler() = default;
+        ~gpu_profiler() = default;
+
+        gpu_profiler(const gpu_profiler&) = delete;
+        gpu_profiler& operator=(const gpu_profiler&) = delete;
+
+        /**
+         * Global switch, disabled by default. Can be enabled with BNB_GL_PROFILE=1 environment variable.
+         */
+        static void set_enabled(bool enabled);
+        static bool is_enabled()
+        {
+            return s_enabled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Bind profiler to the current thread, should be called along with context activation.
+         */
+        static void make_current(gpu_profiler* profiler);
+        static gpu_profiler* current();
+
+        void begin(const char* name);
+        void end();
+
+        /**
+         * Delete query objects. Must be called with the owning context active.
+         */
+        void release();
+
+        /**
+         * Thread safe.
+         */
+        std::vector<stage_stats> get_stats() const;
+        std::string report() const;
+
+    private:
+        static constexpr size_t ring_size = 4;
+        static constexpr double ema_factor = 0.1;
+
+        struct sample
+        {
+            GLuint queries[2]{0, 0};
+            bool pending{false};
+        };
+
+        struct stage
+        {
+            const char* name;
+            std::array<sample, ring_size> ring;
+            size_t head{0};
+            std::chrono::steady_clock::time_point cpu_start;
+            stage_stats stats;
+        };
+
+        size_t find_stage(const char* name);
+        void collect(stage& s, sample& smp);
+
+        static std::atomic<bool> s_enabled;
+
+        std::vector<stage> m_stages;
+        std::vector<size_t> m_open_stages;
+        mutable std::mutex m_stats_mutex;
+    };
+
+    class gpu_scope
+    {
+    public:
+        explicit gpu_scope(const char* name)
+        {
+            if (gpu_profiler::is_enabled()) {
+                m_profiler = gpu_profiler::current();
+                if (m_profiler) {
+                    m_profiler->begin(name);
+                }
+            }
+        }
+
+        ~gpu_scope()
+        {
+            if (m_profiler) {
+                m_profiler->end();
+            }
+        }
+
+        gpu_scope(const gpu_scope&) = delete;
+        gpu_scope& operator=(const gpu_scope&) = delete;
+
+    private:
+        gpu_profiler* m_profiler{nullptr};
+    };
+
+    inline void start_group(const char* name)
+    {
+        if (gpu_profiler::is_enabled()) {
+            if (auto profiler = gpu_profiler::current()) {
+                profiler->begin(name);
+            }
+        }
+    }
+
+    inline void end_group()
+    {
+        if (gpu_profiler::is_enabled()) {
+            if (auto profiler = gpu_profiler::current()) {
+                profiler->end();
+            }
+        }
+    }
+} // bnb::gl
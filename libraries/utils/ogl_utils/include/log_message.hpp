@@ -0,0 +1,17 @@
+#pragma once
+
+#include "logger.hpp"
+
+// By default messages go to the asynchronous rate limited logger from utils,
+// define BNB_WRITE_LOG_MESSAGE to redirect them to your own logging
+#ifndef BNB_WRITE_LOG_MESSAGE
+    #define WRITE_LOG_MESSAGE(sev, message) BNB_LOG(bnb::log::severity::sev, message)
+#else
+    #define WRITE_LOG_MESSAGE(sev, message) BNB_WRITE_LOG_MESSAGE(sev) << message
+#endif
+
+#ifndef BNB_WRITE_LOG_MESSAGE_WITH_LOGGER
+    #define WRITE_LOG_MESSAGE_WITH_LOGGER(logger, sev, message) BNB_LOG(bnb::log::severity::sev, message)
+#else
+    #define WRITE_LOG_MESSAGE_WITH_LOGGER(logger, sev, message) BNB_WRITE_LOG_MESSAGE_WITH_LOGGER(logger, sev) << message
+#endif
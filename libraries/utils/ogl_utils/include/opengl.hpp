@@ -5,6 +5,8 @@
 
 #include <bnb/utils/singleton.hpp>
 
+#include "gpu_profiler.hpp"
+
 namespace bnb::gl
 {
     enum class mali_gpu_family
@@ -53,9 +55,13 @@ namespace bnb::gl
 #define GL_CHECK_ERROR() bnb::gl::context_info::instance().check_error(__FILE__, __LINE__)
 #define GL_CALL(FUNC) [&]() {FUNC; GL_CHECK_ERROR(); }()
 
+#define BNB_GL_CONCAT_IMPL(a, b) a##b
+#define BNB_GL_CONCAT(a, b) BNB_GL_CONCAT_IMPL(a, b)
+
 #define BNB_GL_INIT() ((void) 0)
-#define BNB_GL_START_GROUP(name) ((void) 0)
-#define BNB_GL_END_GROUP() ((void) 0)
+#define BNB_GL_START_GROUP(name) bnb::gl::start_group(name)
+#define BNB_GL_END_GROUP() bnb::gl::end_group()
+// Object labels need KHR_debug which is not guaranteed by the loader
 #define BNB_GL_LABEL(obj, name) ((void) 0)
 
-#define BNB_GL_SCOPE(name) ((void) 0)
+#define BNB_GL_SCOPE(name) bnb::gl::gpu_scope BNB_GL_CONCAT(bnb_gl_scope_, __LINE__)(name)
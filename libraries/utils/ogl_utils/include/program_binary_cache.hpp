@@ -0,0 +1,63 @@
+#pragma once
+
+#include <bnb/utils/singleton.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace bnb
+{
+    /**
+     * On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+     * Entries are keyed by the hash of the shader sources together with the GL vendor,
+     * renderer and version strings, so a driver update never reuses a stale binary.
+     * The cache is disabled until a directory is set, either explicitly or
+     * through the BNB_PROGRAM_CACHE_DIR environment variable.
+     */
+    class program_binary_cache : public bnb::singleton<program_binary_cache>
+    {
+    public:
+        program_binary_cache();
+        virtual ~program_binary_cache() = default;
+
+        /**
+         * Set directory for cached binaries. Empty string disables the cache.
+         *
+         * Example set_directory("/tmp/bnb_program_cache")
+         */
+        void set_directory(const std::string& directory);
+        std::string get_directory() const;
+
+        /**
+         * Must be called with active GL context.
+         *
+         * @return key of the program, empty if the cache is disabled or
+         * driver does not support program binaries
+         */
+        std::string make_key(const char* name, const std::string& vertex_shader_code, const std::string& fragment_shader_code);
+
+        /**
+         * Try to restore program from cache. Returns false if there is no entry
+         * or the driver rejected the binary, in that case the entry is removed.
+         */
+        bool load(const std::string& key, unsigned int program);
+
+        /**
+         * Mark program retrievable, should be called before glLinkProgram.
+         */
+        void prepare(const std::string& key, unsigned int program);
+
+        /**
+         * Save binary of the linked program.
+         */
+        void store(const std::string& key, unsigned int program);
+
+    private:
+        bool is_supported();
+        std::string entry_path(const std::string& key) const;
+
+        mutable std::mutex m_mutex;
+        std::string m_directory;
+    };
+} // bnb
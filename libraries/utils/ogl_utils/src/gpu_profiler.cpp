@@ -0,0 +1,150 @@
+#include "gpu_profiler.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+using namespace bnb::gl;
+
+namespace
+{
+    thread_local gpu_profiler* current_profiler = nullptr;
+
+    bool enabled_from_env()
+    {
+        auto value = std::getenv("BNB_GL_PROFILE");
+        return value != nullptr && std::strcmp(value, "0") != 0;
+    }
+} // namespace
+
+std::atomic<bool> gpu_profiler::s_enabled{enabled_from_env()};
+
+void gpu_profiler::set_enabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void gpu_profiler::make_current(gpu_profiler* profiler)
+{
+    current_profiler = profiler;
+}
+
+gpu_profiler* gpu_profiler::current()
+{
+    return current_profiler;
+}
+
+size_t gpu_profiler::find_stage(const char* name)
+{
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        if (m_stages[i].name == name || std::strcmp(m_stages[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    stage s{};
+    s.name = name;
+    s.stats.name = name;
+    for (auto& smp : s.ring) {
+        glGenQueries(2, smp.queries);
+    }
+
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    m_stages.push_back(std::move(s));
+    return m_stages.size() - 1;
+}
+
+void gpu_profiler::collect(stage& s, sample& smp)
+{
+    smp.pending = false;
+
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(smp.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available != GL_TRUE) {
+        // The GPU is more than ring_size frames behind, skip the sample instead of waiting
+        return;
+    }
+
+    GLuint64 begin_ns = 0;
+    GLuint64 end_ns = 0;
+    glGetQueryObjectui64v(smp.queries[0], GL_QUERY_RESULT, &begin_ns);
+    glGetQueryObjectui64v(smp.queries[1], GL_QUERY_RESULT, &end_ns);
+
+    auto gpu_ms = double(end_ns - begin_ns) / 1e6;
+
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    s.stats.gpu_ms_last = gpu_ms;
+    s.stats.gpu_ms_avg = s.stats.gpu_ms_avg == 0.0 ? gpu_ms : s.stats.gpu_ms_avg + (gpu_ms - s.stats.gpu_ms_avg) * ema_factor;
+}
+
+void gpu_profiler::begin(const char* name)
+{
+    auto index = find_stage(name);
+    auto& s = m_stages[index];
+    auto& smp = s.ring[s.head];
+
+    if (smp.pending) {
+        collect(s, smp);
+    }
+
+    glQueryCounter(smp.queries[0], GL_TIMESTAMP);
+    s.cpu_start = std::chrono::steady_clock::now();
+    m_open_stages.push_back(index);
+}
+
+void gpu_profiler::end()
+{
+    if (m_open_stages.empty()) {
+        return;
+    }
+
+    auto& s = m_stages[m_open_stages.back()];
+    m_open_stages.pop_back();
+
+    auto& smp = s.ring[s.head];
+    glQueryCounter(smp.queries[1], GL_TIMESTAMP);
+    smp.pending = true;
+    s.head = (s.head + 1) % ring_size;
+
+    auto cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s.cpu_start).count();
+
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    ++s.stats.samples;
+    s.stats.cpu_ms_last = cpu_ms;
+    s.stats.cpu_ms_avg = s.stats.samples == 1 ? cpu_ms : s.stats.cpu_ms_avg + (cpu_ms - s.stats.cpu_ms_avg) * ema_factor;
+}
+
+void gpu_profiler::release()
+{
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    for (auto& s : m_stages) {
+        for (auto& smp : s.ring) {
+            glDeleteQueries(2, smp.queries);
+        }
+    }
+    m_stages.clear();
+    m_open_stages.clear();
+}
+
+std::vector<gpu_profiler::stage_stats> gpu_profiler::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    std::vector<stage_stats> result;
+    result.reserve(m_stages.size());
+    for (const auto& s : m_stages) {
+        result.push_back(s.stats);
+    }
+    return result;
+}
+
+std::string gpu_profiler::report() const
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    for (const auto& s : get_stats()) {
+        out << s.name << ": cpu " << s.cpu_ms_avg << " ms, gpu " << s.gpu_ms_avg << " ms"
+            << (s.gpu_ms_avg > s.cpu_ms_avg ? " (gpu-bound)" : "") << "\n";
+    }
+    return out.str();
+}
@@ -1,16 +1,6 @@
 #include <bnb/utils/singleton.hpp>
 
-#ifndef BNB_WRITE_LOG_MESSAGE
-    #define WRITE_LOG_MESSAGE(severity, message) std::cout << #severity << message << std::endl
-#else
-    #define WRITE_LOG_MESSAGE(severity, message) BNB_WRITE_LOG_MESSAGE(severity) << message
-#endif
-
-#ifndef BNB_WRITE_LOG_MESSAGE_WITH_LOGGER
-    #define WRITE_LOG_MESSAGE_WITH_LOGGER(logger, severity, message) std::cout << #severity << message << std::endl
-#else
-    #define WRITE_LOG_MESSAGE_WITH_LOGGER(logger, severity, message) BNB_WRITE_LOG_MESSAGE_WITH_LOGGER(logger, severity) << message
-#endif
+#include "log_message.hpp"
 
 #include <iostream>
 #include <string>
@@ -1,6 +1,7 @@
 #include "program.hpp"
 
 #include "opengl.hpp"
+#include "program_binary_cache.hpp"
 #include <sstream>
 
 #define BNB_GLSL_VERSION "#version 330 core \n"
@@ -27,6 +28,15 @@ program::program(const char* name, const char* vertex_shader_code, const char* f
     const char* vsc_str_c = vsc_str.c_str();
     const char* fsc_str_c = fsc_str.c_str();
 
+    auto& cache = program_binary_cache::instance();
+    auto cache_key = cache.make_key(name, vsc_str, fsc_str);
+
+    unsigned int shaderProgram = glCreateProgram();
+    if (cache.load(cache_key, shaderProgram)) {
+        m_handle = shaderProgram;
+        return;
+    }
+
     int vertexShader = glCreateShader(GL_VERTEX_SHADER);
     GL_CALL(glShaderSource(vertexShader, 1, &vsc_str_c, NULL));
     GL_CALL(glCompileShader(vertexShader));
@@ -54,7 +64,7 @@ program::program(const char* name, const char* vertex_shader_code, const char* f
     }
 
     // link shaders
-    unsigned int shaderProgram = glCreateProgram();
+    cache.prepare(cache_key, shaderProgram);
     GL_CALL(glAttachShader(shaderProgram, vertexShader));
     GL_CALL(glAttachShader(shaderProgram, fragmentShader));
     GL_CALL(glLinkProgram(shaderProgram));
@@ -67,6 +77,8 @@ program::program(const char* name, const char* vertex_shader_code, const char* f
     GL_CALL(glDeleteShader(vertexShader));
     GL_CALL(glDeleteShader(fragmentShader));
 
+    cache.store(cache_key, shaderProgram);
+
     m_handle = shaderProgram;
 }
 
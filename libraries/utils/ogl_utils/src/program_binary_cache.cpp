@@ -0,0 +1,219 @@
+#include "program_binary_cache.hpp"
+
+#include "log_message.hpp"
+#include "opengl.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+#endif
+
+using namespace bnb;
+
+namespace
+{
+    constexpr uint32_t cache_magic = 0x504e4242; // "BBNP"
+    constexpr uint32_t cache_version = 1;
+
+    struct entry_header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t binary_format;
+        uint32_t binary_size;
+        uint64_t key_hash;
+    };
+
+    uint64_t fnv1a(uint64_t hash, const char* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    uint64_t fnv1a(uint64_t hash, const std::string& str)
+    {
+        // include terminating zero to separate fields
+        return fnv1a(hash, str.c_str(), str.size() + 1);
+    }
+
+    std::string gl_string(GLenum name)
+    {
+        auto str = reinterpret_cast<const char*>(glGetString(name));
+        return str != nullptr ? str : "";
+    }
+
+    std::string to_hex(uint64_t value)
+    {
+        static const char* digits = "0123456789abcdef";
+        std::string result(16, '0');
+        for (int i = 15; i >= 0; --i) {
+            result[i] = digits[value & 0xf];
+            value >>= 4;
+        }
+        return result;
+    }
+
+    uint64_t key_hash(const std::string& key)
+    {
+        auto pos = key.rfind('-');
+        return std::strtoull(key.c_str() + (pos == std::string::npos ? 0 : pos + 1), nullptr, 16);
+    }
+} // namespace
+
+program_binary_cache::program_binary_cache()
+{
+    if (auto dir = std::getenv("BNB_PROGRAM_CACHE_DIR")) {
+        set_directory(dir);
+    }
+}
+
+void program_binary_cache::set_directory(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_directory = directory;
+    if (m_directory.empty()) {
+        return;
+    }
+
+#ifdef _WIN32
+    _mkdir(m_directory.c_str());
+#else
+    mkdir(m_directory.c_str(), 0755);
+#endif
+
+    if (m_directory.back() != '/' && m_directory.back() != '\\') {
+        m_directory += '/';
+    }
+}
+
+std::string program_binary_cache::get_directory() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_directory;
+}
+
+bool program_binary_cache::is_supported()
+{
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+std::string program_binary_cache::make_key(const char* name, const std::string& vertex_shader_code, const std::string& fragment_shader_code)
+{
+    if (get_directory().empty() || !is_supported()) {
+        return {};
+    }
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = fnv1a(hash, gl_string(GL_VENDOR));
+    hash = fnv1a(hash, gl_string(GL_RENDERER));
+    hash = fnv1a(hash, gl_string(GL_VERSION));
+    hash = fnv1a(hash, gl_string(GL_SHADING_LANGUAGE_VERSION));
+    hash = fnv1a(hash, vertex_shader_code);
+    hash = fnv1a(hash, fragment_shader_code);
+
+    return std::string(name) + "-" + to_hex(hash);
+}
+
+std::string program_binary_cache::entry_path(const std::string& key) const
+{
+    return get_directory() + key + ".bin";
+}
+
+bool program_binary_cache::load(const std::string& key, unsigned int program)
+{
+    if (key.empty()) {
+        return false;
+    }
+
+    auto path = entry_path(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    entry_header header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != cache_magic || header.version != cache_version || header.key_hash != key_hash(key)) {
+        file.close();
+        std::remove(path.c_str());
+        return false;
+    }
+
+    std::vector<char> binary(header.binary_size);
+    file.read(binary.data(), binary.size());
+    if (!file) {
+        file.close();
+        std::remove(path.c_str());
+        return false;
+    }
+    file.close();
+
+    GL_CALL(glProgramBinary(program, header.binary_format, binary.data(), GLsizei(binary.size())));
+
+    GLint success = GL_FALSE;
+    GL_CALL(glGetProgramiv(program, GL_LINK_STATUS, &success));
+    if (success != GL_TRUE) {
+        // Driver rejected the binary (e.g. it was updated), recompile from sources
+        WRITE_LOG_MESSAGE(warning, "Program binary rejected by driver: " << key);
+        std::remove(path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void program_binary_cache::prepare(const std::string& key, unsigned int program)
+{
+    if (key.empty()) {
+        return;
+    }
+    GL_CALL(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+}
+
+void program_binary_cache::store(const std::string& key, unsigned int program)
+{
+    if (key.empty()) {
+        return;
+    }
+
+    GLint length = 0;
+    GL_CALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GL_CALL(glGetProgramBinary(program, length, &length, &format, binary.data()));
+
+    entry_header header{cache_magic, cache_version, format, uint32_t(length), key_hash(key)};
+
+    // Write into temporary file first, so concurrent processes never see partial entries
+    auto path = entry_path(key);
+    auto tmp_path = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            WRITE_LOG_MESSAGE(warning, "Failed to write program binary cache: " << tmp_path);
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), length);
+    }
+
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bnb
+{
+    /**
+     * Read-only memory mapped archive of effect files. Packing the many small files of
+     * an effect into one file replaces random reads on a cold disk with one sequential read.
+     *
+     * Layout: "BNBFXB01" magic, uint32 file count, then for every file uint32 path length,
+     * path, uint64 offset and uint64 size. File data follows the table, every file starts
+     * on a 4 KB boundary. Integers are little-endian.
+     *
+     * Example
+     *     effect_bundle::pack("effects/Afro", "effects/Afro.bnb");
+     *     auto bundle = effect_bundle::open("effects/Afro.bnb");
+     *     bundle->extract("/tmp/Afro");
+     */
+    class effect_bundle
+    {
+    public:
+        static constexpr const char* extension = ".bnb";
+
+        struct entry
+        {
+            // Relative to the effect directory, '/' separators
+            std::string path;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        /**
+         * Write all files under the directory into a bundle.
+         *
+         * @return false if the directory is empty or a file can't be read or written
+         */
+        static bool pack(const std::string& directory, const std::string& bundle_path);
+
+        /**
+         * @return nullptr if the file can't be mapped or isn't a valid bundle
+         */
+        static std::unique_ptr<effect_bundle> open(const std::string& bundle_path);
+
+        ~effect_bundle();
+
+        effect_bundle(const effect_bundle&) = delete;
+        effect_bundle& operator=(const effect_bundle&) = delete;
+
+        const std::vector<entry>& entries() const
+        {
+            return m_entries;
+        }
+
+        const uint8_t* data(const entry& e) const
+        {
+            return m_data + e.offset;
+        }
+
+        /**
+         * Ask the OS to read the whole mapping in background.
+         */
+        void prefetch() const;
+
+        /**
+         * FNV-1a hash of the whole bundle, tells apart bundles with the same file name.
+         */
+        uint64_t content_hash() const;
+
+        /**
+         * Write all files into the directory, existing files are overwritten.
+         */
+        bool extract(const std::string& directory) const;
+
+    private:
+        effect_bundle() = default;
+
+        bool parse();
+
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#else
+        int m_fd = -1;
+#endif
+        std::vector<entry> m_entries;
+    };
+} // bnb
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bnb::files
+{
+    bool is_directory(const std::string& path);
+
+    /**
+     * Paths of all regular files under the directory, recursively, relative to it
+     * with '/' separators. Empty if the directory doesn't exist.
+     */
+    std::vector<std::string> list_files(const std::string& directory);
+
+    /**
+     * @return false if the file can't be read
+     */
+    bool read_file(const std::string& path, std::vector<uint8_t>& data);
+
+    /**
+     * Create the directory and all missing parents.
+     *
+     * @return false if the directory doesn't exist afterwards
+     */
+    bool create_directories(const std::string& path);
+
+    /**
+     * Create or overwrite the file, missing parent directories are created.
+     *
+     * @return false if the file can't be written
+     */
+    bool write_file(const std::string& path, const uint8_t* data, size_t size);
+
+    /**
+     * Move a file or directory in one step, readers see either nothing or the whole of it.
+     *
+     * @return false if the target exists, a directory is never merged into another one
+     */
+    bool rename_path(const std::string& from, const std::string& to);
+
+    /**
+     * Remove the file or the directory with everything in it.
+     */
+    void remove_all(const std::string& path);
+
+    /**
+     * Ask the OS to read the whole file into the page cache in background,
+     * so following reads don't wait for the disk.
+     *
+     * @return size of the file, 0 if it can't be opened
+     */
+    size_t prefetch_file(const std::string& path);
+
+    std::string join(const std::string& directory, const std::string& name);
+
+    /**
+     * Last component of the path, separators at the end are ignored
+     */
+    std::string file_name(const std::string& path);
+
+    std::string temp_directory();
+
+    /**
+     * Directory in temp_directory() only the current user can access, created if missing.
+     * On POSIX it is suffixed with the user id and verified to be owned by the user with mode 0700.
+     *
+     * @return empty if the directory can't be created or belongs to someone else
+     */
+    std::string user_temp_directory(const std::string& name);
+} // bnb::files
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <thread>
+
+namespace bnb::log
+{
+    enum class severity : uint8_t
+    {
+        debug,
+        info,
+        warning,
+        error,
+    };
+
+    /**
+     * Asynchronous logger. Producers format a message into a stack buffer and put it into
+     * a bounded lock-free queue, a background thread writes messages to the console.
+     * If the queue is full the message is dropped instead of blocking the caller.
+     */
+    class logger
+    {
+    public:
+        static constexpr size_t max_message_size = 512;
+        static constexpr size_t queue_size = 1024; // must be power of two
+
+        static logger& instance();
+
+        ~logger();
+
+        void set_min_severity(severity min_severity)
+        {
+            m_min_severity.store(min_severity, std::memory_order_relaxed);
+        }
+
+        bool is_enabled(severity sev) const
+        {
+            return sev >= m_min_severity.load(std::memory_order_relaxed);
+        }
+
+        void push(severity sev, const char* text, size_t length);
+
+        /**
+         * Block until all queued messages are written.
+         */
+        void flush();
+
+        uint64_t dropped_messages() const
+        {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct slot
+        {
+            std::atomic<size_t> sequence;
+            severity sev;
+            uint16_t length;
+            char text[max_message_size];
+        };
+
+        logger();
+
+        void thread_func();
+        bool pop_and_write();
+
+        std::unique_ptr<slot[]> m_slots;
+        std::atomic<size_t> m_enqueue_pos{0};
+        size_t m_dequeue_pos{0};
+
+        std::atomic<severity> m_min_severity{severity::info};
+        std::atomic<uint64_t> m_dropped{0};
+        std::atomic<uint64_t> m_written{0};
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::condition_variable m_flush_cv;
+        std::atomic<bool> m_sleeping{false};
+        std::atomic<bool> m_stop{false};
+        std::thread m_thread;
+    };
+
+    /**
+     * Per call site rate limiter, allows a burst of messages per second
+     * and counts the suppressed ones.
+     */
+    class call_site
+    {
+    public:
+        static constexpr uint32_t messages_per_second = 5;
+
+        bool allow(uint32_t& suppressed);
+
+    private:
+        std::atomic<int64_t> m_window_start_ms{0};
+        std::atomic<uint32_t> m_count{0};
+        std::atomic<uint32_t> m_suppressed{0};
+    };
+
+    /**
+     * Formats single message without heap allocations, the message is queued on destruction.
+     */
+    class message
+    {
+    public:
+        message(severity sev, uint32_t suppressed);
+        ~message();
+
+        std::ostream& stream()
+        {
+            return m_stream;
+        }
+
+    private:
+        class buffer : public std::streambuf
+        {
+        public:
+            buffer()
+            {
+                setp(m_data, m_data + logger::max_message_size);
+            }
+
+            const char* data() const
+            {
+                return m_data;
+            }
+
+            size_t size() const
+            {
+                return size_t(pptr() - pbase());
+            }
+
+        private:
+            char m_data[logger::max_message_size];
+        };
+
+        severity m_severity;
+        uint32_t m_suppressed;
+        buffer m_buffer;
+        std::ostream m_stream;
+    };
+} // bnb::log
+
+#define BNB_LOG(sev, msg)                                                                \
+    do {                                                                                 \
+        static bnb::log::call_site bnb_log_call_site;                                    \
+        uint32_t bnb_log_suppressed = 0;                                                 \
+        if (bnb::log::logger::instance().is_enabled(sev)                                 \
+            && bnb_log_call_site.allow(bnb_log_suppressed)) {                            \
+            bnb::log::message bnb_log_message(sev, bnb_log_suppressed);                  \
+            bnb_log_message.stream() << msg;                                             \
+        }                                                                                \
+    } while (0)
+
+#define BNB_LOG_DEBUG(msg) BNB_LOG(bnb::log::severity::debug, msg)
+#define BNB_LOG_INFO(msg) BNB_LOG(bnb::log::severity::info, msg)
+#define BNB_LOG_WARNING(msg) BNB_LOG(bnb::log::severity::warning, msg)
+#define BNB_LOG_ERROR(msg) BNB_LOG(bnb::log::severity::error, msg)
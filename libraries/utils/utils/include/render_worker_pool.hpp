@@ -0,0 +1,117 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace bnb
+{
+    /**
+     * Fixed set of worker threads serving many sessions. Each session is pinned to the
+     * least loaded worker when created and has its own task queue, tasks of one session
+     * run in order on the same thread. A worker takes one task from each of its sessions
+     * in turn, so a busy session can't starve the others.
+     *
+     * Example
+     *     auto pool = render_worker_pool::create(4);
+     *     auto session = pool->create_session();
+     *     session->enqueue([]() { ... }).get();
+     */
+    class render_worker_pool : public std::enable_shared_from_this<render_worker_pool>
+    {
+    public:
+        class session
+        {
+        public:
+            ~session();
+
+            session(const session&) = delete;
+            session& operator=(const session&) = delete;
+
+            template<class F>
+            auto enqueue(F&& f) -> std::future<typename std::result_of<F()>::type>;
+
+            /**
+             * True when called from a task of this session
+             */
+            bool is_current() const;
+
+            /**
+             * True when called on the thread serving this session, from a task of any session
+             */
+            bool is_worker_thread() const;
+
+            size_t worker_index() const
+            {
+                return m_worker_index;
+            }
+
+        private:
+            friend class render_worker_pool;
+
+            session(std::shared_ptr<render_worker_pool> pool, size_t worker_index);
+
+            void push(std::function<void()> task);
+
+            std::shared_ptr<render_worker_pool> m_pool;
+            size_t m_worker_index;
+            // Guarded by the mutex of the worker
+            std::deque<std::function<void()>> m_tasks;
+        };
+
+        /**
+         * @param name thread name shown in the trace timeline, must be a string literal
+         */
+        static std::shared_ptr<render_worker_pool> create(size_t threads, const char* name = "render_worker");
+
+        ~render_worker_pool();
+
+        render_worker_pool(const render_worker_pool&) = delete;
+        render_worker_pool& operator=(const render_worker_pool&) = delete;
+
+        /**
+         * Session keeps the pool alive. Pending tasks of a destroyed session are discarded.
+         */
+        std::shared_ptr<session> create_session();
+
+        size_t size() const
+        {
+            return m_workers.size();
+        }
+
+    private:
+        struct worker
+        {
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::vector<session*> sessions;
+            size_t next_session{0};
+            bool stop{false};
+            std::thread thread;
+        };
+
+        render_worker_pool(size_t threads, const char* name);
+
+        void worker_func(worker& w, const char* name);
+
+        std::vector<std::unique_ptr<worker>> m_workers;
+    };
+
+    template<class F>
+    auto render_worker_pool::session::enqueue(F&& f) -> std::future<typename std::result_of<F()>::type>
+    {
+        using return_type = typename std::result_of<F()>::type;
+
+        auto task = std::make_shared<std::packaged_task<return_type()>>(std::forward<F>(f));
+        auto res = task->get_future();
+        push([task]() { (*task)(); });
+        return res;
+    }
+
+} // bnb
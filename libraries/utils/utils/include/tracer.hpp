@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace bnb::trace
+{
+    // Frame ids start from 1, events with this id are not tied to a frame and have no frame argument
+    constexpr uint64_t no_frame = 0;
+
+    /**
+     * Timeline tracer producing Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+     * Every thread writes into its own preallocated ring buffer, so recording an event
+     * is a few stores without locks or allocations. The buffer of a thread is created on
+     * its first event, call BNB_TRACE_THREAD_NAME at thread start to do it up front.
+     *
+     * Tracing is disabled by default. Set BNB_TRACE_FILE=<path> to enable it on startup
+     * and dump the timeline at exit, or use set_enabled()/dump() at runtime.
+     */
+    class tracer
+    {
+    public:
+        static constexpr size_t events_per_thread = 1 << 16;
+
+        static tracer& instance();
+
+        ~tracer();
+
+        void set_enabled(bool enabled);
+        bool is_enabled() const
+        {
+            return m_enabled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * File to write the timeline to when process exits. Empty string disables it.
+         */
+        void set_exit_dump_path(const std::string& path);
+
+        /**
+         * Name shown for the calling thread. name must be a string literal.
+         */
+        void set_thread_name(const char* name);
+
+        /**
+         * Record complete event. name must be a string literal.
+         */
+        void complete(const char* name, uint64_t frame_id, uint64_t start_us, uint64_t end_us);
+
+        /**
+         * Record instant event. name must be a string literal.
+         */
+        void instant(const char* name, uint64_t frame_id);
+
+        /**
+         * Write recorded events of all threads as trace-event JSON.
+         * Safe to call while tracing, the oldest events of a buffer being
+         * overwritten at that moment are skipped.
+         *
+         * @return true on success
+         */
+        bool dump(const std::string& path) const;
+
+        uint64_t now_us() const
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - m_start).count());
+        }
+
+    private:
+        struct event
+        {
+            const char* name;
+            uint64_t frame_id;
+            uint64_t ts_us;
+            uint64_t dur_us;
+            char phase;
+        };
+
+        struct thread_buffer
+        {
+            uint32_t tid{0};
+            std::atomic<const char*> name{nullptr};
+            std::unique_ptr<event[]> events;
+            std::atomic<uint64_t> head{0};
+        };
+
+        tracer();
+
+        thread_buffer& local_buffer();
+        void push(const event& e);
+
+        std::chrono::steady_clock::time_point m_start;
+        std::atomic<bool> m_enabled{false};
+        std::string m_exit_dump_path;
+
+        mutable std::mutex m_buffers_mutex;
+        std::vector<std::shared_ptr<thread_buffer>> m_buffers;
+    };
+
+    class scope
+    {
+    public:
+        scope(const char* name, uint64_t frame_id)
+        {
+            auto& t = tracer::instance();
+            if (t.is_enabled()) {
+                m_name = name;
+                m_frame_id = frame_id;
+                m_start_us = t.now_us();
+            }
+        }
+
+        ~scope()
+        {
+            if (m_name != nullptr) {
+                auto& t = tracer::instance();
+                t.complete(m_name, m_frame_id, m_start_us, t.now_us());
+            }
+        }
+
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+    private:
+        const char* m_name{nullptr};
+        uint64_t m_frame_id{0};
+        uint64_t m_start_us{0};
+    };
+} // bnb::trace
+
+#define BNB_TRACE_CONCAT_IMPL(a, b) a##b
+#define BNB_TRACE_CONCAT(a, b) BNB_TRACE_CONCAT_IMPL(a, b)
+
+#define BNB_TRACE_SCOPE(name, frame_id) bnb::trace::scope BNB_TRACE_CONCAT(bnb_trace_scope_, __LINE__)(name, frame_id)
+#define BNB_TRACE_SCOPE_NO_FRAME(name) BNB_TRACE_SCOPE(name, bnb::trace::no_frame)
+#define BNB_TRACE_INSTANT(name, frame_id) bnb::trace::tracer::instance().instant(name, frame_id)
+#define BNB_TRACE_THREAD_NAME(name) bnb::trace::tracer::instance().set_thread_name(name)
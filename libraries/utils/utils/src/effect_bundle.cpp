@@ -0,0 +1,251 @@
+#include "effect_bundle.hpp"
+
+#include "file_utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr char magic[8] = {'B', 'N', 'B', 'F', 'X', 'B', '0', '1'};
+    constexpr uint64_t alignment = 4096;
+
+    uint64_t align(uint64_t value)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void put(std::vector<uint8_t>& out, uint64_t value, size_t bytes)
+    {
+        for (size_t i = 0; i < bytes; ++i) {
+            out.push_back(uint8_t(value >> (8 * i)));
+        }
+    }
+
+    uint64_t get(const uint8_t* data, size_t bytes)
+    {
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= uint64_t(data[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    // Entries come from a file, they must not point outside of the target directory
+    bool is_safe_path(const std::string& path)
+    {
+        if (path.empty() || path[0] == '/' || path[0] == '\\' || path.find(':') != std::string::npos) {
+            return false;
+        }
+        size_t begin = 0;
+        while (begin <= path.size()) {
+            auto end = path.find_first_of("/\\", begin);
+            if (end == std::string::npos) {
+                end = path.size();
+            }
+            if (path.compare(begin, end - begin, "..") == 0) {
+                return false;
+            }
+            begin = end + 1;
+        }
+        return true;
+    }
+} // namespace
+
+namespace bnb
+{
+    bool effect_bundle::pack(const std::string& directory, const std::string& bundle_path)
+    {
+        auto files = files::list_files(directory);
+        if (files.empty()) {
+            return false;
+        }
+
+        std::vector<std::vector<uint8_t>> contents(files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (!files::read_file(files::join(directory, files[i]), contents[i])) {
+                return false;
+            }
+        }
+
+        uint64_t table_size = sizeof(magic) + 4;
+        for (const auto& file : files) {
+            table_size += 4 + file.size() + 8 + 8;
+        }
+
+        std::vector<uint8_t> header(magic, magic + sizeof(magic));
+        put(header, files.size(), 4);
+        uint64_t offset = align(table_size);
+        for (size_t i = 0; i < files.size(); ++i) {
+            put(header, files[i].size(), 4);
+            header.insert(header.end(), files[i].begin(), files[i].end());
+            put(header, offset, 8);
+            put(header, contents[i].size(), 8);
+            offset = align(offset + contents[i].size());
+        }
+
+        std::ofstream out(bundle_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        std::vector<char> padding(alignment, 0);
+        out.write(reinterpret_cast<const char*>(header.data()), std::streamsize(header.size()));
+        uint64_t position = header.size();
+        for (const auto& content : contents) {
+            out.write(padding.data(), std::streamsize(align(position) - position));
+            out.write(reinterpret_cast<const char*>(content.data()), std::streamsize(content.size()));
+            position = align(position) + content.size();
+        }
+        return static_cast<bool>(out);
+    }
+
+    std::unique_ptr<effect_bundle> effect_bundle::open(const std::string& bundle_path)
+    {
+        std::unique_ptr<effect_bundle> bundle(new effect_bundle());
+
+#ifdef _WIN32
+        auto file = CreateFileA(bundle_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+        bundle->m_file = file;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            return nullptr;
+        }
+        bundle->m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (bundle->m_mapping == nullptr) {
+            return nullptr;
+        }
+        bundle->m_data = static_cast<const uint8_t*>(MapViewOfFile(bundle->m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (bundle->m_data == nullptr) {
+            return nullptr;
+        }
+        bundle->m_size = size_t(size.QuadPart);
+#else
+        bundle->m_fd = ::open(bundle_path.c_str(), O_RDONLY);
+        if (bundle->m_fd < 0) {
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(bundle->m_fd, &st) != 0 || st.st_size == 0) {
+            return nullptr;
+        }
+        auto data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, bundle->m_fd, 0);
+        if (data == MAP_FAILED) {
+            return nullptr;
+        }
+        bundle->m_data = static_cast<const uint8_t*>(data);
+        bundle->m_size = size_t(st.st_size);
+#endif
+
+        if (!bundle->parse()) {
+            return nullptr;
+        }
+        return bundle;
+    }
+
+    effect_bundle::~effect_bundle()
+    {
+#ifdef _WIN32
+        if (m_data != nullptr) {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping != nullptr) {
+            CloseHandle(m_mapping);
+        }
+        if (m_file != nullptr) {
+            CloseHandle(m_file);
+        }
+#else
+        if (m_data != nullptr) {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+#endif
+    }
+
+    bool effect_bundle::parse()
+    {
+        if (m_size < sizeof(magic) + 4 || std::memcmp(m_data, magic, sizeof(magic)) != 0) {
+            return false;
+        }
+        size_t position = sizeof(magic);
+        auto count = get(m_data + position, 4);
+        position += 4;
+
+        m_entries.reserve(size_t(std::min<uint64_t>(count, m_size / 20)));
+        for (uint64_t i = 0; i < count; ++i) {
+            if (m_size - position < 4) {
+                return false;
+            }
+            auto length = size_t(get(m_data + position, 4));
+            position += 4;
+            if (m_size - position < length + 16) {
+                return false;
+            }
+            entry e;
+            e.path.assign(reinterpret_cast<const char*>(m_data + position), length);
+            position += length;
+            e.offset = get(m_data + position, 8);
+            e.size = get(m_data + position + 8, 8);
+            position += 16;
+            if (e.offset > m_size || e.size > m_size - e.offset || !is_safe_path(e.path)) {
+                return false;
+            }
+            m_entries.push_back(std::move(e));
+        }
+        return true;
+    }
+
+    void effect_bundle::prefetch() const
+    {
+#if defined(_WIN32) && _WIN32_WINNT >= 0x0602
+        WIN32_MEMORY_RANGE_ENTRY range{const_cast<uint8_t*>(m_data), m_size};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#elif defined(_WIN32)
+        // Without PrefetchVirtualMemory pages are faulted in one by one
+        volatile uint8_t sink = 0;
+        for (size_t offset = 0; offset < m_size; offset += alignment) {
+            sink = sink + m_data[offset];
+        }
+#else
+        madvise(const_cast<uint8_t*>(m_data), m_size, MADV_WILLNEED);
+#endif
+    }
+
+    uint64_t effect_bundle::content_hash() const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < m_size; ++i) {
+            hash = (hash ^ m_data[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    bool effect_bundle::extract(const std::string& directory) const
+    {
+        if (!files::create_directories(directory)) {
+            return false;
+        }
+        for (const auto& e : m_entries) {
+            if (!files::write_file(files::join(directory, e.path), data(e), size_t(e.size))) {
+                return false;
+            }
+        }
+        return true;
+    }
+} // bnb
@@ -0,0 +1,276 @@
+#include "file_utils.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    void list_files_impl(const std::string& root, const std::string& relative, std::vector<std::string>& files)
+    {
+        auto directory = relative.empty() ? root : bnb::files::join(root, relative);
+
+#ifdef _WIN32
+        WIN32_FIND_DATAA data;
+        auto handle = FindFirstFileA(bnb::files::join(directory, "*").c_str(), &data);
+        if (handle == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        do {
+            std::string name = data.cFileName;
+            if (name == "." || name == "..") {
+                continue;
+            }
+            auto path = relative.empty() ? name : relative + "/" + name;
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                list_files_impl(root, path, files);
+            } else {
+                files.push_back(path);
+            }
+        } while (FindNextFileA(handle, &data));
+        FindClose(handle);
+#else
+        auto dir = opendir(directory.c_str());
+        if (dir == nullptr) {
+            return;
+        }
+        while (auto entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name == "." || name == "..") {
+                continue;
+            }
+            auto path = relative.empty() ? name : relative + "/" + name;
+            struct stat st;
+            if (stat(bnb::files::join(directory, name).c_str(), &st) != 0) {
+                continue;
+            }
+            if (S_ISDIR(st.st_mode)) {
+                list_files_impl(root, path, files);
+            } else if (S_ISREG(st.st_mode)) {
+                files.push_back(path);
+            }
+        }
+        closedir(dir);
+#endif
+    }
+
+    void remove_all_impl(const std::string& path)
+    {
+#ifdef _WIN32
+        auto attributes = GetFileAttributesA(path.c_str());
+        if (attributes == INVALID_FILE_ATTRIBUTES) {
+            return;
+        }
+        if (!(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            DeleteFileA(path.c_str());
+            return;
+        }
+        WIN32_FIND_DATAA data;
+        auto handle = FindFirstFileA(bnb::files::join(path, "*").c_str(), &data);
+        if (handle != INVALID_HANDLE_VALUE) {
+            do {
+                std::string name = data.cFileName;
+                if (name != "." && name != "..") {
+                    remove_all_impl(bnb::files::join(path, name));
+                }
+            } while (FindNextFileA(handle, &data));
+            FindClose(handle);
+        }
+        RemoveDirectoryA(path.c_str());
+#else
+        struct stat st;
+        if (lstat(path.c_str(), &st) != 0) {
+            return;
+        }
+        if (!S_ISDIR(st.st_mode)) {
+            unlink(path.c_str());
+            return;
+        }
+        if (auto dir = opendir(path.c_str())) {
+            while (auto entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name != "." && name != "..") {
+                    remove_all_impl(bnb::files::join(path, name));
+                }
+            }
+            closedir(dir);
+        }
+        rmdir(path.c_str());
+#endif
+    }
+} // namespace
+
+namespace bnb::files
+{
+    bool is_directory(const std::string& path)
+    {
+#ifdef _WIN32
+        auto attributes = GetFileAttributesA(path.c_str());
+        return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+    }
+
+    std::vector<std::string> list_files(const std::string& directory)
+    {
+        std::vector<std::string> files;
+        list_files_impl(directory, "", files);
+        return files;
+    }
+
+    bool read_file(const std::string& path, std::vector<uint8_t>& data)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            return false;
+        }
+        auto size = static_cast<size_t>(file.tellg());
+        file.seekg(0);
+        data.resize(size);
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), std::streamsize(size)));
+    }
+
+    bool create_directories(const std::string& path)
+    {
+        if (path.empty() || is_directory(path)) {
+            return !path.empty();
+        }
+        auto separator = path.find_last_of("/\\", path.size() - 2);
+        if (separator != std::string::npos && separator != 0) {
+            create_directories(path.substr(0, separator));
+        }
+#ifdef _WIN32
+        CreateDirectoryA(path.c_str(), nullptr);
+#else
+        mkdir(path.c_str(), 0755);
+#endif
+        return is_directory(path);
+    }
+
+    bool write_file(const std::string& path, const uint8_t* data, size_t size)
+    {
+        auto separator = path.find_last_of("/\\");
+        if (separator != std::string::npos && separator != 0) {
+            create_directories(path.substr(0, separator));
+        }
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        return static_cast<bool>(file.write(reinterpret_cast<const char*>(data), std::streamsize(size)));
+    }
+
+    bool rename_path(const std::string& from, const std::string& to)
+    {
+#ifdef _WIN32
+        return MoveFileExA(from.c_str(), to.c_str(), 0) != 0;
+#else
+        // rename() replaces an empty target directory, it is checked for first
+        struct stat st;
+        if (lstat(to.c_str(), &st) == 0) {
+            return false;
+        }
+        return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+    }
+
+    void remove_all(const std::string& path)
+    {
+        remove_all_impl(path);
+    }
+
+    size_t prefetch_file(const std::string& path)
+    {
+#ifdef _WIN32
+        // No readahead hint for regular reads, the file is read through a small buffer
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return 0;
+        }
+        std::vector<char> buffer(256 * 1024);
+        size_t size = 0;
+        while (file.read(buffer.data(), std::streamsize(buffer.size())) || file.gcount() > 0) {
+            size += size_t(file.gcount());
+        }
+        return size;
+#else
+        auto fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return 0;
+        }
+        struct stat st;
+        size_t size = fstat(fd, &st) == 0 ? size_t(st.st_size) : 0;
+    #if defined(__APPLE__)
+        radvisory advice{0, int(std::min<size_t>(size, INT32_MAX))};
+        fcntl(fd, F_RDADVISE, &advice);
+    #else
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    #endif
+        close(fd);
+        return size;
+#endif
+    }
+
+    std::string join(const std::string& directory, const std::string& name)
+    {
+        if (directory.empty() || directory.back() == '/' || directory.back() == '\\') {
+            return directory + name;
+        }
+        return directory + "/" + name;
+    }
+
+    std::string file_name(const std::string& path)
+    {
+        auto end = path.find_last_not_of("/\\");
+        if (end == std::string::npos) {
+            return {};
+        }
+        auto separator = path.find_last_of("/\\", end);
+        auto begin = separator == std::string::npos ? 0 : separator + 1;
+        return path.substr(begin, end + 1 - begin);
+    }
+
+    std::string temp_directory()
+    {
+#ifdef _WIN32
+        char buffer[MAX_PATH + 1];
+        auto length = GetTempPathA(sizeof(buffer), buffer);
+        return length > 0 ? std::string(buffer, length) : std::string(".");
+#else
+        auto tmp = std::getenv("TMPDIR");
+        return tmp != nullptr && *tmp != '\0' ? std::string(tmp) : std::string("/tmp");
+#endif
+    }
+
+    std::string user_temp_directory(const std::string& name)
+    {
+#ifdef _WIN32
+        // The temp directory is per user already
+        auto path = join(temp_directory(), name);
+        return create_directories(path) ? path : std::string();
+#else
+        auto uid = getuid();
+        auto path = join(temp_directory(), name + "-" + std::to_string(uid));
+        mkdir(path.c_str(), 0700);
+        // A directory created in advance by another user may contain files planted by them
+        struct stat st;
+        if (lstat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != uid || (st.st_mode & 077) != 0) {
+            return {};
+        }
+        return path;
+#endif
+    }
+} // bnb::files
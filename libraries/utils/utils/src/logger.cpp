@@ -0,0 +1,178 @@
+#include "logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    const char* severity_prefix(bnb::log::severity sev)
+    {
+        switch (sev) {
+            // clang-format off
+            case bnb::log::severity::debug:   return "[DEBUG] ";
+            case bnb::log::severity::info:    return "[INFO] ";
+            case bnb::log::severity::warning: return "[WARNING] ";
+            case bnb::log::severity::error:   return "[ERROR] ";
+            // clang-format on
+        }
+        return "";
+    }
+
+    int64_t steady_ms()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+} // namespace
+
+namespace bnb::log
+{
+    static_assert((logger::queue_size & (logger::queue_size - 1)) == 0, "queue_size must be power of two");
+
+    logger& logger::instance()
+    {
+        static logger instance;
+        return instance;
+    }
+
+    logger::logger()
+        : m_slots(std::make_unique<slot[]>(queue_size))
+    {
+        for (size_t i = 0; i < queue_size; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_thread = std::thread([this]() { thread_func(); });
+    }
+
+    logger::~logger()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+
+    void logger::push(severity sev, const char* text, size_t length)
+    {
+        // Bounded MPMC queue by D. Vyukov, only single consumer is used here
+        auto pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        slot* s = nullptr;
+        for (;;) {
+            s = &m_slots[pos & (queue_size - 1)];
+            auto seq = s->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        s->sev = sev;
+        s->length = static_cast<uint16_t>(std::min(length, max_message_size));
+        std::memcpy(s->text, text, s->length);
+        s->sequence.store(pos + 1, std::memory_order_release);
+
+        if (m_sleeping.load(std::memory_order_acquire)) {
+            m_cv.notify_one();
+        }
+    }
+
+    bool logger::pop_and_write()
+    {
+        auto& s = m_slots[m_dequeue_pos & (queue_size - 1)];
+        if (s.sequence.load(std::memory_order_acquire) != m_dequeue_pos + 1) {
+            return false;
+        }
+
+        std::cout << severity_prefix(s.sev);
+        std::cout.write(s.text, s.length);
+        std::cout << '\n';
+
+        s.sequence.store(m_dequeue_pos + queue_size, std::memory_order_release);
+        ++m_dequeue_pos;
+        return true;
+    }
+
+    void logger::thread_func()
+    {
+        using namespace std::chrono_literals;
+
+        for (;;) {
+            bool written = false;
+            while (pop_and_write()) {
+                written = true;
+                m_written.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (written) {
+                std::cout.flush();
+                m_flush_cv.notify_all();
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_stop) {
+                while (pop_and_write()) {
+                }
+                std::cout.flush();
+                m_flush_cv.notify_all();
+                return;
+            }
+
+            m_sleeping.store(true, std::memory_order_release);
+            // Timeout covers a producer that checked the flag right before it was set
+            m_cv.wait_for(lock, 50ms);
+            m_sleeping.store(false, std::memory_order_release);
+        }
+    }
+
+    void logger::flush()
+    {
+        using namespace std::chrono_literals;
+
+        auto target = m_enqueue_pos.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.notify_one();
+        while (m_written.load(std::memory_order_relaxed) < target && !m_stop) {
+            m_flush_cv.wait_for(lock, 10ms);
+        }
+    }
+
+    bool call_site::allow(uint32_t& suppressed)
+    {
+        auto now = steady_ms();
+        auto window_start = m_window_start_ms.load(std::memory_order_relaxed);
+        if (now - window_start >= 1000
+            && m_window_start_ms.compare_exchange_strong(window_start, now, std::memory_order_relaxed)) {
+            m_count.store(0, std::memory_order_relaxed);
+        }
+
+        if (m_count.fetch_add(1, std::memory_order_relaxed) < messages_per_second) {
+            suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        m_suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    message::message(severity sev, uint32_t suppressed)
+        : m_severity(sev)
+        , m_suppressed(suppressed)
+        , m_stream(&m_buffer) {}
+
+    message::~message()
+    {
+        if (m_suppressed > 0) {
+            m_stream << " (" << m_suppressed << " similar messages suppressed)";
+        }
+        logger::instance().push(m_severity, m_buffer.data(), m_buffer.size());
+    }
+} // bnb::log
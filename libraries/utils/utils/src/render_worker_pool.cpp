@@ -0,0 +1,138 @@
+#include "render_worker_pool.hpp"
+
+#include "tracer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+    thread_local const bnb::render_worker_pool::session* current_session = nullptr;
+} // namespace
+
+namespace bnb
+{
+    std::shared_ptr<render_worker_pool> render_worker_pool::create(size_t threads, const char* name)
+    {
+        // we use "new" instead of "make_shared" because the constructor is private
+        return std::shared_ptr<render_worker_pool>(new render_worker_pool(std::max<size_t>(threads, 1), name));
+    }
+
+    render_worker_pool::render_worker_pool(size_t threads, const char* name)
+    {
+        for (size_t i = 0; i < threads; ++i) {
+            m_workers.push_back(std::make_unique<worker>());
+        }
+        for (auto& w : m_workers) {
+            w->thread = std::thread([this, &w = *w, name]() { worker_func(w, name); });
+        }
+    }
+
+    render_worker_pool::~render_worker_pool()
+    {
+        for (auto& w : m_workers) {
+            {
+                std::lock_guard<std::mutex> lock(w->mutex);
+                w->stop = true;
+            }
+            w->cv.notify_one();
+        }
+        for (auto& w : m_workers) {
+            w->thread.join();
+        }
+    }
+
+    std::shared_ptr<render_worker_pool::session> render_worker_pool::create_session()
+    {
+        size_t index = 0;
+        size_t min_sessions = SIZE_MAX;
+        for (size_t i = 0; i < m_workers.size(); ++i) {
+            std::lock_guard<std::mutex> lock(m_workers[i]->mutex);
+            if (m_workers[i]->sessions.size() < min_sessions) {
+                min_sessions = m_workers[i]->sessions.size();
+                index = i;
+            }
+        }
+
+        // we use "new" instead of "make_shared" because the constructor is private
+        std::shared_ptr<session> s(new session(shared_from_this(), index));
+
+        auto& w = *m_workers[index];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.sessions.push_back(s.get());
+        return s;
+    }
+
+    void render_worker_pool::worker_func(worker& w, const char* name)
+    {
+        trace::tracer::instance().set_thread_name(name);
+
+        for (;;) {
+            std::function<void()> task;
+            const session* owner = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(w.mutex);
+                w.cv.wait(lock, [&w]() {
+                    return w.stop || std::any_of(w.sessions.begin(), w.sessions.end(),
+                        [](const session* s) { return !s->m_tasks.empty(); });
+                });
+                if (w.stop) {
+                    return;
+                }
+
+                // Round robin over sessions, one task per turn
+                auto count = w.sessions.size();
+                for (size_t i = 0; i < count; ++i) {
+                    auto index = (w.next_session + i) % count;
+                    auto s = w.sessions[index];
+                    if (!s->m_tasks.empty()) {
+                        task = std::move(s->m_tasks.front());
+                        s->m_tasks.pop_front();
+                        owner = s;
+                        w.next_session = index + 1;
+                        break;
+                    }
+                }
+            }
+
+            current_session = owner;
+            task();
+            current_session = nullptr;
+        }
+    }
+
+    render_worker_pool::session::session(std::shared_ptr<render_worker_pool> pool, size_t worker_index)
+        : m_pool(std::move(pool))
+        , m_worker_index(worker_index) {}
+
+    render_worker_pool::session::~session()
+    {
+        auto& w = *m_pool->m_workers[m_worker_index];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.sessions.erase(std::find(w.sessions.begin(), w.sessions.end(), this));
+    }
+
+    void render_worker_pool::session::push(std::function<void()> task)
+    {
+        auto& w = *m_pool->m_workers[m_worker_index];
+        {
+            std::lock_guard<std::mutex> lock(w.mutex);
+            if (w.stop) {
+                throw std::runtime_error("enqueue on stopped render_worker_pool");
+            }
+            m_tasks.push_back(std::move(task));
+        }
+        w.cv.notify_one();
+    }
+
+    bool render_worker_pool::session::is_current() const
+    {
+        return current_session == this;
+    }
+
+    bool render_worker_pool::session::is_worker_thread() const
+    {
+        return m_pool->m_workers[m_worker_index]->thread.get_id() == std::this_thread::get_id();
+    }
+} // bnb
@@ -0,0 +1,156 @@
+#include "tracer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+#ifdef _WIN32
+    #include <process.h>
+    #define BNB_TRACE_GETPID _getpid
+#else
+    #include <unistd.h>
+    #define BNB_TRACE_GETPID getpid
+#endif
+
+namespace
+{
+    // Events close to the write position may be overwritten while dumping
+    constexpr uint64_t dump_guard_events = 1024;
+
+    void write_escaped(std::ostream& out, const char* str)
+    {
+        for (; *str != '\0'; ++str) {
+            if (*str == '"' || *str == '\\') {
+                out << '\\';
+            }
+            out << *str;
+        }
+    }
+} // namespace
+
+namespace bnb::trace
+{
+    tracer& tracer::instance()
+    {
+        static tracer instance;
+        return instance;
+    }
+
+    tracer::tracer()
+        : m_start(std::chrono::steady_clock::now())
+    {
+        if (auto path = std::getenv("BNB_TRACE_FILE")) {
+            m_exit_dump_path = path;
+            m_enabled = !m_exit_dump_path.empty();
+        }
+    }
+
+    tracer::~tracer()
+    {
+        if (!m_exit_dump_path.empty()) {
+            dump(m_exit_dump_path);
+        }
+    }
+
+    void tracer::set_enabled(bool enabled)
+    {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void tracer::set_exit_dump_path(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(m_buffers_mutex);
+        m_exit_dump_path = path;
+    }
+
+    tracer::thread_buffer& tracer::local_buffer()
+    {
+        thread_local std::shared_ptr<thread_buffer> buffer;
+        if (!buffer) {
+            buffer = std::make_shared<thread_buffer>();
+            buffer->events = std::make_unique<event[]>(events_per_thread);
+
+            std::lock_guard<std::mutex> lock(m_buffers_mutex);
+            buffer->tid = static_cast<uint32_t>(m_buffers.size() + 1);
+            m_buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    void tracer::set_thread_name(const char* name)
+    {
+        local_buffer().name.store(name, std::memory_order_relaxed);
+    }
+
+    void tracer::push(const event& e)
+    {
+        auto& buffer = local_buffer();
+        auto head = buffer.head.load(std::memory_order_relaxed);
+        buffer.events[head % events_per_thread] = e;
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+    void tracer::complete(const char* name, uint64_t frame_id, uint64_t start_us, uint64_t end_us)
+    {
+        push({name, frame_id, start_us, end_us - start_us, 'X'});
+    }
+
+    void tracer::instant(const char* name, uint64_t frame_id)
+    {
+        if (is_enabled()) {
+            push({name, frame_id, now_us(), 0, 'i'});
+        }
+    }
+
+    bool tracer::dump(const std::string& path) const
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+
+        auto pid = BNB_TRACE_GETPID();
+        bool first = true;
+        auto separator = [&out, &first]() {
+            out << (first ? "\n" : ",\n");
+            first = false;
+        };
+
+        std::lock_guard<std::mutex> lock(m_buffers_mutex);
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        for (const auto& buffer : m_buffers) {
+            if (auto name = buffer->name.load(std::memory_order_relaxed)) {
+                separator();
+                out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                    << ",\"args\":{\"name\":\"";
+                write_escaped(out, name);
+                out << "\"}}";
+            }
+
+            auto head = buffer->head.load(std::memory_order_acquire);
+            auto capacity = events_per_thread - dump_guard_events;
+            auto first_event = head > capacity ? head - capacity : 0;
+            for (auto i = first_event; i < head; ++i) {
+                const auto& e = buffer->events[i % events_per_thread];
+                separator();
+                out << "{\"name\":\"";
+                write_escaped(out, e.name);
+                out << "\",\"ph\":\"" << e.phase << "\",\"ts\":" << e.ts_us;
+                if (e.phase == 'X') {
+                    out << ",\"dur\":" << e.dur_us;
+                } else {
+                    out << ",\"s\":\"t\"";
+                }
+                out << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid;
+                if (e.frame_id != no_frame) {
+                    out << ",\"args\":{\"frame\":" << e.frame_id << "}";
+                }
+                out << "}";
+            }
+        }
+        out << "\n]}\n";
+
+        return static_cast<bool>(out);
+    }
+} // bnb::trace
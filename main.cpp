@@ -4,9 +4,14 @@
 #include "glfw_window.hpp"
 #include "render_thread.hpp"
 #include "renderer.hpp"
+#include "program_binary_cache.hpp"
+#include "tracer.hpp"
 
 #include <bnb/spal/camera/ocv_based.hpp>
 
+#include <atomic>
+#include <future>
+
 #define BNB_CLIENT_TOKEN <#Place your token here#>
 
 int main()
@@ -16,10 +21,54 @@ int main()
     constexpr int32_t oep_height = 720;
 
     std::shared_ptr<glfw_window> window = nullptr; // Should be declared here to destroy in the last turn
+    ioep_sptr oep = nullptr;
+    std::shared_ptr<bnb::render::render_thread> render_t = nullptr;
+    // Camera frames are skipped until the whole pipeline is created
+    std::atomic<bool> pipeline_ready{false};
+
+    // Callback for received frame from the camera
+    // Set BNB_TRACE_FILE=trace.json to record a timeline of all pipeline threads,
+    // open it in chrome://tracing or ui.perfetto.dev
+    auto ef_cb = [&oep, &render_t, &pipeline_ready](bnb::full_image_t image) {
+        BNB_TRACE_THREAD_NAME("camera");
+        if (!pipeline_ready.load(std::memory_order_acquire)) {
+            return;
+        }
+        // The frame id is assigned by process_image_async, the "submit" event inside this span carries it
+        BNB_TRACE_SCOPE_NO_FRAME("camera_frame");
+
+        auto image_ptr = std::make_shared<bnb::full_image_t>(std::move(image));
+
+        // Callback for received pixel buffer from the offscreen effect player
+        auto get_pixel_buffer_callback = [image_ptr, render_t](std::optional<ipb_sptr> pb) {
+            if (pb.has_value()) {
+                // Callback for update data in render thread
+                auto render_callback = [render_t, frame_id = (*pb)->get_frame_id()](std::optional<int> texture_id) {
+                    if (texture_id.has_value()) {
+                        render_t->update_data(*texture_id, frame_id);
+                    }
+                };
+                // Get texture id from shared context and render it
+                (*pb)->get_texture(render_callback);
+            }
+        };
+
+        std::optional<bnb::interfaces::orient_format> target_orient{ { bnb::camera_orientation::deg_0, true } };
+        oep->process_image_async(image_ptr, get_pixel_buffer_callback, target_orient);
+    };
+    // Opening the camera device takes hundreds of milliseconds, it is done while
+    // GL contexts and the effect player are being initialized
+    auto camera_future = std::async(std::launch::async, [ef_cb]() { return bnb::create_camera_device(ef_cb, 0); });
 
     // Init glfw for glfw_window 
     glfwInit();
 
+    // Keep linked shader programs between launches to skip GLSL compilation on startup,
+    // BNB_PROGRAM_CACHE_DIR environment variable takes precedence
+    if (bnb::program_binary_cache::instance().get_directory().empty()) {
+        bnb::program_binary_cache::instance().set_directory("program_cache");
+    }
+
     // Create an instance of our offscreen_render_target implementation, you can use your own.
     // pass dimension of processing frame
     auto ort = std::make_shared<bnb::offscreen_render_target>(oep_width, oep_height);
@@ -28,14 +77,17 @@ int main()
     // token, dimension of processing frame (for best performance it is better to coincide
     // with camera frame dimensions), manual sound (useful fro some cases when sound 
     // should start and specified moment
-    auto oep = bnb::interfaces::offscreen_effect_player::create({ BNB_RESOURCES_FOLDER }, BNB_CLIENT_TOKEN,
+    oep = bnb::interfaces::offscreen_effect_player::create({ BNB_RESOURCES_FOLDER }, BNB_CLIENT_TOKEN,
                                                oep_width, oep_height, false, ort);
 
     // Make glfw_window and render_thread only for show result of OEP
     // We want to share resources between context, we know that offscreen_render_target is based on GLFW and returned context
     // is GLFWwindow
     window = std::make_shared<glfw_window>("OEP Example", reinterpret_cast<GLFWwindow*>(ort->get_sharing_context()));
-    std::shared_ptr<bnb::render::render_thread> render_t = std::make_shared<bnb::render::render_thread>(window->get_window(), oep_width, oep_height);
+    // Preview thread sleeps until a new frame arrives, use present_mode::mailbox to avoid blocking on vsync
+    // or present_mode::unthrottled for benchmarking
+    render_t = std::make_shared<bnb::render::render_thread>(
+        window->get_window(), oep_width, oep_height, bnb::render::present_mode::vsync);
     auto key_func = [](GLFWwindow* window, int key, int scancode, int action, int mods) {
         if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
             glfwSetWindowShouldClose(window, GLFW_TRUE);
@@ -45,29 +97,9 @@ int main()
 
     oep->load_effect("effects/Afro");
 
-    // Create and run instance of camera, pass callback for frames
-    // Callback for received frame from the camera
-    auto ef_cb = [&oep, render_t](bnb::full_image_t image) {
-        auto image_ptr = std::make_shared<bnb::full_image_t>(std::move(image));
-
-        // Callback for received pixel buffer from the offscreen effect player
-        auto get_pixel_buffer_callback = [image_ptr, render_t](std::optional<ipb_sptr> pb) {
-            if (pb.has_value()) {
-                // Callback for update data in render thread
-                auto render_callback = [render_t](std::optional<int> texture_id) {
-                    if (texture_id.has_value()) {
-                        render_t->update_data(*texture_id);
-                    }
-                };
-                // Get texture id from shared context and render it
-                (*pb)->get_texture(render_callback);
-            }
-        };
-
-        std::optional<bnb::interfaces::orient_format> target_orient{ { bnb::camera_orientation::deg_0, true } };
-        oep->process_image_async(image_ptr, get_pixel_buffer_callback, target_orient);
-    };
-    std::shared_ptr<bnb::camera_base> m_camera_ptr = bnb::create_camera_device(ef_cb, 0);
+    pipeline_ready.store(true, std::memory_order_release);
+    // Camera instance runs until the end of main, frames are delivered to ef_cb
+    std::shared_ptr<bnb::camera_base> m_camera_ptr = camera_future.get();
 
     window->show(oep_width, oep_height);
     window->run_main_loop();
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "thread_pool.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace bnb
+{
+    /**
+     * Warms the page cache before an effect is loaded. Files of an effect directory are
+     * passed to the OS readahead from several threads, so the effect player reads them from
+     * memory instead of issuing many small random reads on a cold disk.
+     *
+     * An effect may also be shipped as a bundle, "<effect>.bnb" next to where the directory
+     * would be (see effect_bundle). The bundle is mapped and extracted once per process to
+     * a temporary directory named after its content, the effect is loaded from there.
+     *
+     * One prefetcher with its worker threads serves all effect players of the process.
+     */
+    class effect_prefetcher
+    {
+    public:
+        using resolved_cb = std::function<void(const std::string& path)>;
+        using prefetched_cb = std::function<void(size_t bytes)>;
+
+        static std::shared_ptr<effect_prefetcher> instance();
+
+        explicit effect_prefetcher(size_t threads = 4);
+
+        /**
+         * Start reading effect files in background. Doesn't block.
+         *
+         * @param search_paths directories relative effect paths are resolved against
+         * @param done called with the size of the files once readahead is issued, usually on a worker thread, may be empty
+         */
+        void prefetch(const std::string& effect, const std::vector<std::string>& search_paths, prefetched_cb done = nullptr);
+
+        /**
+         * Pass the path for the effect manager to the callback. It is called at once unless the
+         * effect is a bundle still being extracted, then it is called on a worker thread
+         * when the extraction finishes. Doesn't block.
+         */
+        void resolve(const std::string& effect, const std::vector<std::string>& search_paths, resolved_cb callback);
+
+    private:
+        struct bundle_state
+        {
+            bool extracted{false};
+            std::string path;
+            std::vector<resolved_cb> waiting;
+        };
+
+        static std::string find_directory(const std::string& effect, const std::vector<std::string>& search_paths);
+        static std::string find_bundle(const std::string& effect, const std::vector<std::string>& search_paths);
+        static std::string extract_bundle(const std::string& effect, const std::string& bundle);
+        void readahead(const std::string& directory, prefetched_cb done);
+
+        // Must be called with m_mutex locked
+        bundle_state& start_extraction(const std::string& effect, const std::string& bundle);
+
+        size_t m_threads;
+
+        std::mutex m_mutex;
+        // Keyed by the bundle path, so every effect player gets the same extraction
+        std::map<std::string, bundle_state> m_bundles;
+
+        thread_pool m_workers;
+    };
+} // bnb
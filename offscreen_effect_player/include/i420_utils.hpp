@@ -0,0 +1,36 @@
+#pragma once
+
+#include <bnb/types/full_image.hpp>
+
+#include "interfaces/formats.hpp"
+
+#include <vector>
+
+namespace bnb::i420
+{
+    /**
+     * Scratch I420 image with tightly packed planes, reused between frames to avoid allocations
+     */
+    struct buffer
+    {
+        std::vector<uint8_t> data;
+        uint8_t* y{nullptr};
+        uint8_t* u{nullptr};
+        uint8_t* v{nullptr};
+        int width{0};
+        int height{0};
+
+        void resize(int w, int h);
+    };
+
+    // NV12 and I420 require even dimensions
+    inline int32_t even(int32_t value)
+    {
+        return value & ~1;
+    }
+
+    /**
+     * Convert the rect of an NV12 or 8 bit per channel image, out must have the size of the rect
+     */
+    void from_image(const full_image_t& image, const interfaces::image_rect& rect, buffer& out);
+} // bnb::i420
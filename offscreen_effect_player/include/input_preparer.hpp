@@ -0,0 +1,30 @@
+#pragma once
+
+#include <bnb/types/full_image.hpp>
+
+#include "interfaces/formats.hpp"
+#include "plane_pool.hpp"
+
+namespace bnb
+{
+    /**
+     * CPU stage converting incoming frames to NV12, cropping and downscaling them
+     * to the working size. Thread safe, used from the OEP input workers.
+     */
+    class input_preparer
+    {
+    public:
+        explicit input_preparer(plane_pool_sptr plane_pool);
+
+        /**
+         * The source image is only read, so it may be still shared with the caller.
+         *
+         * @param max_width frames larger than max_width x max_height are downscaled keeping aspect ratio
+         */
+        full_image_t prepare(const full_image_t& image, const std::optional<interfaces::image_rect>& crop,
+                             uint32_t max_width, uint32_t max_height);
+
+    private:
+        plane_pool_sptr m_plane_pool;
+    };
+} // bnb
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "interfaces/metrics.hpp"
+
+#include <atomic>
+#include <memory>
+
+namespace bnb
+{
+    /**
+     * Lock-free counters behind interfaces::oep_metrics, shared between
+     * offscreen_effect_player and its pixel buffers.
+     */
+    struct metrics_counters
+    {
+        std::atomic<uint64_t> frames_submitted{0};
+        std::atomic<uint64_t> frames_rendered{0};
+        std::atomic<uint64_t> frames_passthrough{0};
+        std::atomic<uint64_t> frames_dropped_queue_busy{0};
+        std::atomic<uint64_t> frames_dropped_pb_locked{0};
+        std::atomic<uint64_t> frames_dropped_draw_timeout{0};
+        std::atomic<uint64_t> frames_dropped_deadline{0};
+        std::atomic<uint64_t> bytes_read_back{0};
+        std::atomic<uint64_t> conversions{0};
+        std::atomic<uint64_t> conversion_time_us{0};
+        std::atomic<uint64_t> allocations_avoided{0};
+        std::atomic<uint64_t> effects_activated{0};
+        std::atomic<uint64_t> effect_prefetch_hits{0};
+        std::atomic<uint64_t> effect_prefetch_misses{0};
+        std::atomic<uint64_t> resolution_changes{0};
+        std::atomic<uint64_t> shm_frames_written{0};
+        std::atomic<uint64_t> shm_frames_skipped{0};
+        std::atomic<uint32_t> processing_width{0};
+        std::atomic<uint32_t> processing_height{0};
+        std::atomic<uint64_t> last_effect_swap_latency_us{0};
+        std::atomic<uint64_t> last_effect_warmup_us{0};
+        std::atomic<uint64_t> time_to_first_frame_us{0};
+        std::atomic<uint64_t> last_frame_latency_us{0};
+        std::atomic<uint32_t> pixel_buffers_in_flight{0};
+
+        interfaces::oep_metrics snapshot() const
+        {
+            interfaces::oep_metrics m;
+            m.frames_submitted = frames_submitted.load(std::memory_order_relaxed);
+            m.frames_rendered = frames_rendered.load(std::memory_order_relaxed);
+            m.frames_passthrough = frames_passthrough.load(std::memory_order_relaxed);
+            m.frames_dropped_queue_busy = frames_dropped_queue_busy.load(std::memory_order_relaxed);
+            m.frames_dropped_pb_locked = frames_dropped_pb_locked.load(std::memory_order_relaxed);
+            m.frames_dropped_draw_timeout = frames_dropped_draw_timeout.load(std::memory_order_relaxed);
+            m.frames_dropped_deadline = frames_dropped_deadline.load(std::memory_order_relaxed);
+            m.bytes_read_back = bytes_read_back.load(std::memory_order_relaxed);
+            m.conversions = conversions.load(std::memory_order_relaxed);
+            m.conversion_time_us = conversion_time_us.load(std::memory_order_relaxed);
+            m.allocations_avoided = allocations_avoided.load(std::memory_order_relaxed);
+            m.effects_activated = effects_activated.load(std::memory_order_relaxed);
+            m.effect_prefetch_hits = effect_prefetch_hits.load(std::memory_order_relaxed);
+            m.effect_prefetch_misses = effect_prefetch_misses.load(std::memory_order_relaxed);
+            m.resolution_changes = resolution_changes.load(std::memory_order_relaxed);
+            m.shm_frames_written = shm_frames_written.load(std::memory_order_relaxed);
+            m.shm_frames_skipped = shm_frames_skipped.load(std::memory_order_relaxed);
+            m.processing_width = processing_width.load(std::memory_order_relaxed);
+            m.processing_height = processing_height.load(std::memory_order_relaxed);
+            m.last_effect_swap_latency_us = last_effect_swap_latency_us.load(std::memory_order_relaxed);
+            m.last_effect_warmup_us = last_effect_warmup_us.load(std::memory_order_relaxed);
+            m.time_to_first_frame_us = time_to_first_frame_us.load(std::memory_order_relaxed);
+            m.last_frame_latency_us = last_frame_latency_us.load(std::memory_order_relaxed);
+            m.pixel_buffers_in_flight = pixel_buffers_in_flight.load(std::memory_order_relaxed);
+            return m;
+        }
+    };
+
+    using metrics_counters_sptr = std::shared_ptr<metrics_counters>;
+} // bnb
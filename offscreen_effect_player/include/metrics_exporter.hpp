@@ -0,0 +1,69 @@
+#pragma once
+
+#include "interfaces/offscreen_effect_player.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace bnb
+{
+    /**
+     * Periodically exports metrics of registered offscreen effect players
+     * in Prometheus text format to a file and/or a loopback HTTP endpoint.
+     * Instances are held by weak pointers and disappear from the output once destroyed.
+     */
+    class metrics_exporter
+    {
+    public:
+        explicit metrics_exporter(std::chrono::milliseconds period = std::chrono::seconds(5));
+        ~metrics_exporter();
+
+        metrics_exporter(const metrics_exporter&) = delete;
+        metrics_exporter& operator=(const metrics_exporter&) = delete;
+
+        /**
+         * Register instance, name is used as the "instance" label value.
+         */
+        void add_instance(const std::string& name, const ioep_sptr& oep);
+        void remove_instance(const std::string& name);
+
+        /**
+         * Write metrics to the file every period. File is replaced atomically.
+         */
+        void set_file(const std::string& path);
+
+        /**
+         * Serve metrics on http://127.0.0.1:<port>/metrics.
+         *
+         * @return false if the port can't be bound
+         */
+        bool listen(uint16_t port);
+
+        /**
+         * Current metrics of all alive instances in Prometheus text format.
+         */
+        std::string format();
+
+    private:
+        void file_thread_func();
+        void http_thread_func();
+
+        std::chrono::milliseconds m_period;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::map<std::string, std::weak_ptr<interfaces::offscreen_effect_player>> m_instances;
+        std::string m_file_path;
+
+        std::atomic<bool> m_stop{false};
+        std::thread m_file_thread;
+
+        intptr_t m_listen_socket{-1};
+        std::thread m_http_thread;
+    };
+} // bnb
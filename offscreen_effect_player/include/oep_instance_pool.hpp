@@ -0,0 +1,100 @@
+#pragma once
+
+#include "interfaces/offscreen_effect_player.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bnb
+{
+    struct oep_instance_pool_config
+    {
+        std::vector<std::string> path_to_resources;
+        std::string client_token;
+        int32_t width;
+        int32_t height;
+        bool manual_audio{false};
+
+        // Called on the pool thread for every new instance. On MacOS the render target
+        // window must be created on main thread, e.g. with run_on_main_queue
+        std::function<iort_sptr()> ort_factory;
+        // Shared render threads for all instances, nullptr for own thread per instance
+        std::shared_ptr<render_worker_pool> render_workers;
+
+        // Loaded into idle instances, empty for none
+        std::string default_effect;
+        // Warm-up frames rendered after the default effect is loaded, see set_effect_warmup_frames
+        uint32_t warmup_frames{0};
+
+        size_t min_idle{1};
+        size_t max_idle{8};
+    };
+
+    /**
+     * Keeps initialized offscreen effect players ready, so a session starts without waiting
+     * for effect player creation, render target initialization and effect loading.
+     * Checked out instance returns to the pool when the last reference to it is released
+     * and is reset instead of being destroyed.
+     *
+     * Number of idle instances follows the checkout rate: enough to cover checkouts
+     * arriving while new instances are being created, within [min_idle, max_idle].
+     *
+     * Example
+     *     auto pool = oep_instance_pool::create(config);
+     *     auto oep = pool->checkout();
+     */
+    class oep_instance_pool : public std::enable_shared_from_this<oep_instance_pool>
+    {
+    public:
+        static std::shared_ptr<oep_instance_pool> create(oep_instance_pool_config config);
+
+        ~oep_instance_pool();
+
+        oep_instance_pool(const oep_instance_pool&) = delete;
+        oep_instance_pool& operator=(const oep_instance_pool&) = delete;
+
+        /**
+         * Take an idle instance, creates one synchronously if the pool is empty.
+         *
+         * @return nullptr if the instance can't be created
+         */
+        ioep_sptr checkout();
+
+        size_t idle_count();
+        size_t target_idle_count();
+
+    private:
+        explicit oep_instance_pool(oep_instance_pool_config config);
+
+        ioep_sptr create_instance();
+        void reset_instance(const ioep_sptr& oep);
+        void recycle(ioep_sptr oep);
+        void on_reset(interfaces::offscreen_effect_player* oep);
+        void update_target(std::chrono::steady_clock::time_point now);
+        void thread_func();
+
+        oep_instance_pool_config m_config;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::vector<ioep_sptr> m_idle;
+        // Returned instances until the tasks of the previous session are drained
+        std::vector<ioep_sptr> m_resetting;
+        bool m_stop{false};
+
+        // Arrival rate and creation time estimates, guarded by m_mutex
+        double m_checkouts_per_second{0.0};
+        double m_creation_seconds{1.0};
+        uint32_t m_checkouts_in_period{0};
+        size_t m_target_idle;
+        std::chrono::steady_clock::time_point m_period_start;
+        std::chrono::steady_clock::time_point m_last_shrink;
+
+        std::thread m_thread;
+    };
+
+    using oep_instance_pool_sptr = std::shared_ptr<oep_instance_pool>;
+} // bnb
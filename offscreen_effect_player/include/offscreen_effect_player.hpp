@@ -7,12 +7,24 @@
 #include "interfaces/offscreen_render_target.hpp"
 
 #include "thread_pool.h"
+#include "render_worker_pool.hpp"
 
 #include "pixel_buffer.hpp"
+#include "metrics_counters.hpp"
+#include "plane_pool.hpp"
+#include "input_preparer.hpp"
+#include "prefetch_tracker.hpp"
+#include "effect_prefetcher.hpp"
+#include "resolution_governor.hpp"
+#ifndef _WIN32
+    #include "shm_frame_ring.hpp"
+#endif
 
 
 namespace bnb
 {
+    class pixel_buffer;
+
     class offscreen_effect_player: public interfaces::offscreen_effect_player,
                                    public std::enable_shared_from_this<offscreen_effect_player>
     {
@@ -20,19 +32,44 @@ namespace bnb
         offscreen_effect_player(const std::vector<std::string>& path_to_resources,
             const std::string& client_token,
             int32_t width, int32_t height, bool manual_audio,
-            iort_sptr ort);
+            iort_sptr ort, std::shared_ptr<render_worker_pool> render_workers);
 
     public:
         ~offscreen_effect_player();
 
         void process_image_async(std::shared_ptr<full_image_t> image, oep_pb_ready_cb callback,
                                  std::optional<interfaces::orient_format> target_orient) override;
+        void process_image_async(std::shared_ptr<full_image_t> image, oep_pb_ready_cb callback,
+                                 std::optional<interfaces::orient_format> target_orient,
+                                 const interfaces::frame_timing& timing) override;
+
+        void process_texture_async(int32_t texture_id, interfaces::oep_sync fence, int32_t width, int32_t height,
+                                   camera_orientation orientation, oep_pb_ready_cb callback,
+                                   std::optional<interfaces::orient_format> target_orient) override;
+        void process_texture_async(int32_t texture_id, interfaces::oep_sync fence, int32_t width, int32_t height,
+                                   camera_orientation orientation, oep_pb_ready_cb callback,
+                                   std::optional<interfaces::orient_format> target_orient,
+                                   const interfaces::frame_timing& timing) override;
+
+        void set_scheduling_policy(interfaces::scheduling_policy policy) override;
+        void set_pipelined_readback(bool enabled) override;
+        bool set_shm_output(const std::optional<interfaces::shm_output_config>& config) override;
 
         void surface_changed(int32_t width, int32_t height) override;
 
+        void set_output_size(int32_t width, int32_t height) override;
+        void set_output_layers(const std::vector<interfaces::output_layer>& layers) override;
+
+        void set_input_preparation(const interfaces::input_preparation& preparation) override;
+        void set_resolution_governor(const interfaces::resolution_governor_config& config) override;
+
         void load_effect(const std::string& effect_path) override;
+        void load_effect(const std::string& effect_path, oep_effect_activated_cb callback) override;
         void unload_effect() override;
 
+        void set_effect_warmup_frames(uint32_t frames) override;
+        void preload_effect(const std::string& effect_path) override;
+
         void pause() override;
         void resume() override;
 
@@ -40,22 +77,205 @@ namespace bnb
 
         void call_js_method(const std::string& method, const std::string& param) override;
 
+        void flush(std::function<void()> callback) override;
+
+        interfaces::oep_metrics get_metrics() override;
+
     private:
         friend class interfaces::offscreen_effect_player;
         friend class pixel_buffer;
 
         void read_current_buffer(std::function<void(bnb::data_t data)> callback);
+        void read_layer(size_t layer, std::function<void(bnb::data_t data)> callback);
+        void read_region(const interfaces::image_rect& region, int32_t width, int32_t height,
+                         std::function<void(bnb::data_t data)> callback);
         void get_current_buffer_texture(oep_texture_cb callback);
+        void get_layer_texture(size_t layer, oep_texture_cb callback);
+        void upload_texture(size_t slot, color_plane rgba, int32_t width, int32_t height, oep_texture_cb callback);
+        void read_published(const interfaces::published_frame& frame, const interfaces::image_rect& region,
+                            int32_t width, int32_t height, interfaces::scale_filter filter,
+                            std::function<void(bnb::data_t data)> callback);
+        void scale_published(const interfaces::published_frame& frame, size_t target, int32_t width, int32_t height,
+                             interfaces::scale_filter filter, oep_texture_cb callback);
+
+        // True on the render or readback thread, including tasks of other sessions sharing the render worker
+        bool is_own_thread() const;
+
+        template<typename F>
+        void run_on_render_thread(F f)
+        {
+            run_on(m_scheduler, std::move(f));
+        }
+
+        template<typename F>
+        void run_on_readback_thread(F f)
+        {
+            run_on(m_readback_scheduler, std::move(f));
+        }
+
+        // Calls f immediately on the thread of the session, otherwise schedules it while this instance is alive
+        template<typename F>
+        void run_on(const std::shared_ptr<render_worker_pool::session>& session, F f)
+        {
+            if (session->is_current()) {
+                f(*this);
+                return;
+            }
+
+            std::weak_ptr<offscreen_effect_player> this_ = shared_from_this();
+            session->enqueue([this_, f]() {
+                if (auto this_sp = this_.lock()) {
+                    f(*this_sp);
+                }
+            });
+        }
+
+        std::shared_ptr<pixel_buffer> make_pixel_buffer(camera_orientation orientation);
+        // Pixel buffer of the non-pipelined output, created on first use. May be called from any thread
+        std::shared_ptr<pixel_buffer> ensure_pixel_buffer(camera_orientation orientation);
+        // nullptr until the next ensure_pixel_buffer after a reset
+        std::shared_ptr<pixel_buffer> current_frame();
+        // Called on the render thread when the output changes
+        void reset_current_frame();
+        // Pixel buffer of the next ring slot, nullptr while it is in use. Render thread only
+        std::shared_ptr<pixel_buffer> acquire_published_buffer(camera_orientation orientation);
+
+        full_image_t prepare_input(const full_image_t& image, uint64_t frame_id);
+        // Prepares the frame on the input workers and queues it for rendering.
+        // m_pending_preparations must be incremented by the caller
+        void prepare_and_render(std::shared_ptr<full_image_t> image, oep_pb_ready_cb callback,
+                                interfaces::orient_format target_orient, uint64_t frame_id,
+                                const interfaces::frame_timing& timing);
+        void finish_preparation();
+        void render_frame(std::shared_ptr<full_image_t> image, oep_pb_ready_cb callback,
+                          interfaces::orient_format target_orient, uint64_t frame_id,
+                          const interfaces::frame_timing& timing);
+
+        // Deadline can't be met even if rendering starts right now
+        bool misses_deadline(const interfaces::frame_timing& timing) const;
+        // Render thread only, checks order, deadline and scheduling policy
+        bool can_render(uint64_t frame_id, const interfaces::frame_timing& timing) const;
+
+        // Waits for the effect player to draw the pushed frame, false on timeout
+        bool draw_frame();
+        void deliver_frame(const std::shared_ptr<pixel_buffer>& pb, const oep_pb_ready_cb& callback, uint64_t frame_id,
+                           const interfaces::frame_timing& timing);
+        // Called on the thread delivering the frame
+        void write_shm_output(const std::shared_ptr<pixel_buffer>& pb, uint64_t frame_id,
+                              const interfaces::frame_timing& timing);
+
+        // Resize effect player and render target surfaces, output size stays the same. Render thread only
+        void apply_processing_scale(float scale);
+        void update_render_target_output();
+
+        // Reads effect files into the page cache and records them in the effect cache
+        void prefetch_effect(const std::string& effect);
+
+        // Render thread part of load_effect, called once the bundle of the effect is extracted
+        void load_resolved_effect(const std::string& effect, const std::string& path, const oep_effect_activated_cb& callback,
+                                  std::chrono::steady_clock::time_point start, uint64_t generation);
+
+        // Drives activation of the effect and renders warm-up frames, results are not delivered.
+        // Every frame is a separate render task, live frames and other sessions of the worker run in between
+        void warm_up_effect(const std::string& effect, uint32_t frames);
+        void render_warmup_frame(const std::shared_ptr<full_image_t>& frame, const std::string& effect, uint32_t frames,
+                                 std::chrono::steady_clock::time_point start);
+        bool is_effect_pending(const std::string& effect);
+
+        // Called by effect manager when an effect loaded with load_async is activated
+        void on_effect_activated(const std::string& url);
+
+        // Periodically prints CPU/GPU timings of render stages when BNB_GL_PROFILE is enabled
+        void report_render_stages();
 
     private:
-        bnb::utility m_utility;
-        std::shared_ptr<interfaces::effect_player> m_ep;
+        std::chrono::steady_clock::time_point m_created_at;
+
+        // Declared before the effect player, so render target initialization starts first
+        // and runs on the render thread while the SDK is being initialized
         iort_sptr m_ort;
+        // Own single thread or a session of a shared pool, context is activated by every task
+        std::shared_ptr<render_worker_pool::session> m_scheduler;
+        std::future<void> m_render_target_ready;
+        // Exists if the render target has a readback context, see set_pipelined_readback
+        std::shared_ptr<render_worker_pool::session> m_readback_scheduler;
+        std::atomic<bool> m_pipelined_readback = false;
 
-        thread_pool m_scheduler;
-        std::thread::id render_thread_id;
+        bnb::utility m_utility;
+        std::shared_ptr<interfaces::effect_player> m_ep;
 
+        // Created on the caller thread and reset on the render thread
+        std::mutex m_current_frame_mutex;
         ipb_sptr m_current_frame;
         std::atomic<uint16_t> m_incoming_frame_queue_task_count = 0;
+        std::atomic<uint64_t> m_frame_counter = 0;
+        std::atomic<bool> m_first_frame_rendered = false;
+        std::atomic<interfaces::scheduling_policy> m_scheduling_policy = interfaces::scheduling_policy::latency_first;
+        // Smoothed time from prepare_rendering to a ready frame, written on render thread
+        std::atomic<int64_t> m_render_time_estimate_us = 0;
+
+        std::chrono::steady_clock::time_point m_last_stages_report;
+
+        struct effect_load_request
+        {
+            // Loaded by the effect manager
+            std::string path;
+            // As passed to load_effect
+            std::string effect;
+            std::chrono::steady_clock::time_point start;
+            oep_effect_activated_cb callback;
+        };
+
+        std::shared_ptr<interfaces::effect_activation_completion_listener> m_activation_listener;
+        std::mutex m_effect_requests_mutex;
+        std::vector<effect_load_request> m_effect_requests;
+        std::atomic<uint32_t> m_effect_warmup_frames = 0;
+
+        metrics_counters_sptr m_metrics;
+        plane_pool_sptr m_plane_pool;
+        // Shared by all instances of the process
+        std::shared_ptr<prefetch_tracker> m_prefetch_tracker;
+        std::vector<std::string> m_resource_paths;
+        // Shared by all instances of the process
+        std::shared_ptr<effect_prefetcher> m_effect_prefetcher;
+        std::atomic<uint64_t> m_effect_generation = 0;
+
+        // Frames are converted, cropped and scaled here before reaching the render thread
+        std::shared_ptr<thread_pool> m_input_workers;
+        std::mutex m_preparation_mutex;
+        std::condition_variable m_preparation_cv;
+        uint32_t m_pending_preparations = 0;
+        input_preparer m_input_preparer;
+        std::mutex m_input_mutex;
+        interfaces::input_preparation m_input_preparation;
+        int32_t m_surface_width;
+        int32_t m_surface_height;
+        // Surface size scaled by the governor
+        int32_t m_processing_width;
+        int32_t m_processing_height;
+        int32_t m_output_width = 0;
+        int32_t m_output_height = 0;
+        std::vector<interfaces::output_layer> m_output_layers;
+        // Workers may finish out of order, older frames are dropped. Accessed on render thread only
+        uint64_t m_last_rendered_frame_id = 0;
+        // No effect is loaded, frames bypass the effect player and the GPU. Accessed on render thread only
+        bool m_passthrough = true;
+        struct published_slot
+        {
+            std::shared_ptr<pixel_buffer> pb;
+            // Value of m_output_generation the pixel buffer was made for
+            uint64_t generation = 0;
+        };
+        // Pixel buffers of frames handed to the readback thread, one per output ring slot. Render thread only
+        std::vector<published_slot> m_published_frames;
+        size_t m_next_published_slot = 0;
+        // Incremented when the output size or layers change, pixel buffers of the ring are remade lazily
+        uint64_t m_output_generation = 0;
+        // Held while a frame is written, frames may be delivered on the render and the readback thread
+#ifndef _WIN32
+        std::mutex m_shm_output_mutex;
+        std::unique_ptr<shm::frame_writer> m_shm_output;
+#endif
+        resolution_governor m_governor;
     };
 } // bnb
\ No newline at end of file
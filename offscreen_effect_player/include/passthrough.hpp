@@ -0,0 +1,28 @@
+#pragma once
+
+#include "i420_utils.hpp"
+
+#include <memory>
+
+namespace bnb::passthrough
+{
+    /**
+     * Input frame delivered without an effect, instead of the render target content
+     */
+    struct frame
+    {
+        std::shared_ptr<full_image_t> source;
+        interfaces::orient_format orient;
+    };
+
+    /**
+     * CPU equivalent of rendering the source without an effect: the source is turned upright
+     * and mirrored as the effect player does it, oriented as by offscreen_render_target::orient_image
+     * and stretched to output_width x output_height. The region of the result, in output pixels,
+     * is scaled to width x height.
+     *
+     * @return thread local buffer valid until the next call on the same thread
+     */
+    const i420::buffer& render(const frame& f, int32_t output_width, int32_t output_height,
+                               const interfaces::image_rect& region, int32_t width, int32_t height);
+} // bnb::passthrough
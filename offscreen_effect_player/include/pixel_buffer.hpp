@@ -2,6 +2,9 @@
 
 #include "offscreen_effect_player.hpp"
 #include "interfaces/pixel_buffer.hpp"
+#include "metrics_counters.hpp"
+#include "passthrough.hpp"
+#include "plane_pool.hpp"
 
 namespace bnb
 {
@@ -12,7 +15,8 @@ namespace bnb
     class pixel_buffer: public interfaces::pixel_buffer
     {
     public:
-        pixel_buffer(oep_sptr oep_sptr, uint32_t width, uint32_t height, camera_orientation orientation);
+        pixel_buffer(oep_sptr oep_sptr, uint32_t width, uint32_t height, camera_orientation orientation,
+                     std::vector<interfaces::output_layer> layers = {});
 
         void lock() override;
         void unlock() override;
@@ -22,13 +26,69 @@ namespace bnb
         void get_nv12(oep_image_ready_cb callback) override;
 
         virtual void get_texture(oep_texture_cb callback) override;
+
+        void get_rgba_layer(size_t layer, oep_image_ready_cb callback) override;
+        void get_nv12_layer(size_t layer, oep_image_ready_cb callback) override;
+        void get_texture_layer(size_t layer, oep_texture_cb callback) override;
+
+        void get_rgba_region(const interfaces::image_rect& region, int32_t width, int32_t height,
+                             oep_image_ready_cb callback) override;
+        void get_nv12_region(const interfaces::image_rect& region, int32_t width, int32_t height,
+                             oep_image_ready_cb callback) override;
+
+        uint64_t get_frame_id() override;
+        void set_frame_id(uint64_t frame_id);
+
+        interfaces::frame_timing get_frame_timing() override;
+        void set_frame_timing(const interfaces::frame_timing& timing);
+
+        /**
+         * While set, the buffer content is the source frame instead of the render target and
+         * every getter produces its result on the CPU of the calling thread.
+         */
+        void set_passthrough(std::optional<passthrough::frame> frame);
+
+        /**
+         * While set, the buffer content is a frame published for the readback thread, getters
+         * read it there instead of the render target on the render thread.
+         */
+        void set_published(std::optional<interfaces::published_frame> frame);
+
+        // Y plane followed by interleaved UV plane, strides equal to the width
+        static size_t nv12_size(int32_t width, int32_t height);
+
+        /**
+         * Convert the frame to NV12 straight into out, e.g. a shared memory slot. Must be called
+         * on the thread which delivers the frame, the read is done synchronously there.
+         *
+         * @return bytes written, 0 if the frame doesn't fit or can't be read
+         */
+        size_t write_nv12(uint8_t* out, size_t capacity, int32_t& width, int32_t& height);
     private:
+        void convert_to_rgba(data_t data, uint32_t width, uint32_t height, oep_image_ready_cb callback);
+        void convert_to_nv12(data_t data, uint32_t width, uint32_t height, oep_image_ready_cb callback);
+        void account_conversion(std::chrono::steady_clock::time_point start);
+
+        color_plane passthrough_rgba(const interfaces::image_rect& region, int32_t& width, int32_t& height);
+        full_image_t passthrough_nv12(const interfaces::image_rect& region, int32_t width, int32_t height);
+        void passthrough_texture(size_t slot, const interfaces::image_rect& region, int32_t width, int32_t height,
+                                 oep_texture_cb callback);
+
         oep_wptr m_oep_ptr;
-        uint8_t lock_count = 0;
+        metrics_counters_sptr m_metrics;
+        plane_pool_sptr m_plane_pool;
+        // Published frames are locked on the render thread and unlocked on the readback thread
+        std::atomic<uint8_t> lock_count = 0;
 
         uint32_t m_width = 0;
         uint32_t m_height = 0;
 
         camera_orientation m_orientation;
+        std::vector<interfaces::output_layer> m_layers;
+
+        uint64_t m_frame_id = 0;
+        interfaces::frame_timing m_frame_timing;
+        std::optional<passthrough::frame> m_passthrough;
+        std::optional<interfaces::published_frame> m_published;
     };
 } // bnb
\ No newline at end of file
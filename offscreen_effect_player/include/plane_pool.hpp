@@ -0,0 +1,37 @@
+#pragma once
+
+#include <bnb/types/base_types.hpp>
+
+#include "metrics_counters.hpp"
+
+#include <mutex>
+#include <vector>
+
+namespace bnb
+{
+    /**
+     * Pool of color plane buffers for converted output images. A plane returns to the pool
+     * when the last full_image_t referencing it is destroyed, so consumers releasing frames
+     * in time get their next frame without heap allocations.
+     */
+    class plane_pool : public std::enable_shared_from_this<plane_pool>
+    {
+    public:
+        explicit plane_pool(metrics_counters_sptr metrics, size_t max_free_planes = 6);
+
+        color_plane acquire(size_t size);
+
+    private:
+        using buffer = std::vector<uint8_t>;
+
+        void release(buffer* plane);
+
+        metrics_counters_sptr m_metrics;
+        size_t m_max_free_planes;
+
+        std::mutex m_mutex;
+        std::vector<std::unique_ptr<buffer>> m_free_planes;
+    };
+
+    using plane_pool_sptr = std::shared_ptr<plane_pool>;
+} // bnb
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace bnb
+{
+    /**
+     * Effects whose files were read into the page cache by effect_prefetcher, so later loads
+     * of them skip prefetching. File contents are not kept by the process and no memory is
+     * bounded here, the OS decides how long the files stay in the page cache.
+     *
+     * One tracker is shared by all effect players of the process.
+     */
+    class prefetch_tracker
+    {
+    public:
+        static std::shared_ptr<prefetch_tracker> instance();
+
+        /**
+         * @return true if effect files were prefetched
+         */
+        bool prefetched(const std::string& effect);
+
+        /**
+         * Record effect files read into the page cache, called when prefetching is done.
+         */
+        void add(const std::string& effect);
+
+    private:
+        std::mutex m_mutex;
+        std::unordered_set<std::string> m_effects;
+    };
+} // bnb
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "interfaces/formats.hpp"
+
+#include <chrono>
+#include <optional>
+
+namespace bnb
+{
+    /**
+     * Chooses the processing scale from render times. Scale goes down when the smoothed
+     * render time stays above the frame budget for several frames and goes up only after
+     * a long period well below it, so it doesn't oscillate around the limit.
+     * Not thread safe, used on the render thread.
+     */
+    class resolution_governor
+    {
+    public:
+        explicit resolution_governor(interfaces::resolution_governor_config config = {});
+
+        void set_config(const interfaces::resolution_governor_config& config);
+
+        /**
+         * @return new scale if it has to be changed
+         */
+        std::optional<float> on_frame(std::chrono::microseconds render_time);
+
+        /**
+         * Start over at the maximum scale, e.g. after the surface size is changed
+         */
+        void reset();
+
+        float scale() const
+        {
+            return m_scale;
+        }
+
+    private:
+        float change_scale(float scale);
+
+        interfaces::resolution_governor_config m_config;
+        float m_scale;
+        double m_average_us{0.0};
+        uint32_t m_frames_over{0};
+        uint32_t m_frames_under{0};
+        uint32_t m_cooldown{0};
+    };
+} // bnb
@@ -0,0 +1,212 @@
+#include "effect_prefetcher.hpp"
+
+#include "effect_bundle.hpp"
+#include "file_utils.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace bnb
+{
+    std::shared_ptr<effect_prefetcher> effect_prefetcher::instance()
+    {
+        static std::mutex mutex;
+        static std::weak_ptr<effect_prefetcher> instance;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto prefetcher = instance.lock();
+        if (prefetcher == nullptr) {
+            prefetcher = std::make_shared<effect_prefetcher>();
+            instance = prefetcher;
+        }
+        return prefetcher;
+    }
+
+    effect_prefetcher::effect_prefetcher(size_t threads)
+        : m_threads(std::max<size_t>(threads, 1))
+        , m_workers(m_threads) {}
+
+    void effect_prefetcher::prefetch(const std::string& effect, const std::vector<std::string>& search_paths,
+                                     prefetched_cb done)
+    {
+        if (effect.empty()) {
+            return;
+        }
+
+        auto directory = find_directory(effect, search_paths);
+        if (!directory.empty()) {
+            readahead(directory, std::move(done));
+            return;
+        }
+        // Extracted files of a bundle are just written and mostly in the page cache already
+        resolve(effect, search_paths, [this, effect, done](const std::string& path) {
+            if (path != effect) {
+                readahead(path, done);
+            } else if (done) {
+                done(0);
+            }
+        });
+    }
+
+    void effect_prefetcher::readahead(const std::string& directory, prefetched_cb done)
+    {
+        auto files = std::make_shared<std::vector<std::string>>(files::list_files(directory));
+        if (files->empty()) {
+            if (done) {
+                done(0);
+            }
+            return;
+        }
+
+        // Readahead requests are spread over the workers, each one issues a share of the open/advise calls.
+        // The last worker to finish reports the total size
+        auto workers = std::min(m_threads, files->size());
+        auto remaining = std::make_shared<std::atomic<size_t>>(workers);
+        auto bytes = std::make_shared<std::atomic<size_t>>(0);
+        for (size_t worker = 0; worker < workers; ++worker) {
+            m_workers.enqueue([this, files, directory, worker, remaining, bytes, done]() {
+                size_t read = 0;
+                for (size_t i = worker; i < files->size(); i += m_threads) {
+                    read += files::prefetch_file(files::join(directory, (*files)[i]));
+                }
+                *bytes += read;
+                if (--*remaining == 0 && done) {
+                    done(bytes->load());
+                }
+            });
+        }
+    }
+
+    void effect_prefetcher::resolve(const std::string& effect, const std::vector<std::string>& search_paths,
+                                    resolved_cb callback)
+    {
+        auto bundle = effect.empty() || !find_directory(effect, search_paths).empty()
+            ? std::string() : find_bundle(effect, search_paths);
+        if (bundle.empty()) {
+            callback(effect);
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto& state = start_extraction(effect, bundle);
+        if (!state.extracted) {
+            state.waiting.push_back(std::move(callback));
+            return;
+        }
+        auto path = state.path;
+        lock.unlock();
+        callback(path);
+    }
+
+    effect_prefetcher::bundle_state& effect_prefetcher::start_extraction(const std::string& effect, const std::string& bundle)
+    {
+        auto it = m_bundles.find(bundle);
+        if (it != m_bundles.end()) {
+            return it->second;
+        }
+
+        auto& state = m_bundles[bundle];
+        m_workers.enqueue([this, effect, bundle]() {
+            auto path = extract_bundle(effect, bundle);
+
+            std::vector<resolved_cb> waiting;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto& state = m_bundles[bundle];
+                state.extracted = true;
+                state.path = path;
+                waiting.swap(state.waiting);
+            }
+            for (auto& callback : waiting) {
+                callback(path);
+            }
+        });
+        return state;
+    }
+
+    std::string effect_prefetcher::find_directory(const std::string& effect, const std::vector<std::string>& search_paths)
+    {
+        if (files::is_directory(effect)) {
+            return effect;
+        }
+        for (const auto& path : search_paths) {
+            auto candidate = files::join(path, effect);
+            if (files::is_directory(candidate)) {
+                return candidate;
+            }
+        }
+        return {};
+    }
+
+    std::string effect_prefetcher::find_bundle(const std::string& effect, const std::vector<std::string>& search_paths)
+    {
+        auto is_file = [](const std::string& path) {
+            return std::ifstream(path).good() && !files::is_directory(path);
+        };
+
+        auto name = effect + effect_bundle::extension;
+        if (is_file(name)) {
+            return name;
+        }
+        for (const auto& path : search_paths) {
+            auto candidate = files::join(path, name);
+            if (is_file(candidate)) {
+                return candidate;
+            }
+        }
+        return {};
+    }
+
+    std::string effect_prefetcher::extract_bundle(const std::string& effect, const std::string& bundle_path)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto bundle = effect_bundle::open(bundle_path);
+        if (bundle == nullptr) {
+            BNB_LOG_WARNING("Effect bundle " << bundle_path << " is invalid");
+            return effect;
+        }
+        bundle->prefetch();
+
+        // Extracted scripts are run by the effect player, only the current user may write there
+        auto root = files::user_temp_directory("bnb_effects");
+        if (root.empty()) {
+            BNB_LOG_WARNING("No private directory to extract effect bundle " << bundle_path);
+            return effect;
+        }
+
+        // Named after the content, bundles with the same file name don't overwrite each other
+        // and a directory extracted by another process or an earlier run is reused
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(bundle->content_hash()));
+        auto directory = files::join(root, files::file_name(effect) + "-" + hash);
+        if (files::is_directory(directory)) {
+            return directory;
+        }
+
+        // Extracted aside and renamed into place, a partially written directory is never loaded
+        static std::atomic<uint64_t> staging_counter{0};
+        auto staging = directory + ".tmp" + std::to_string(std::random_device()()) + "-" + std::to_string(++staging_counter);
+        if (!bundle->extract(staging)) {
+            BNB_LOG_WARNING("Failed to extract effect bundle " << bundle_path << " to " << staging);
+            files::remove_all(staging);
+            return effect;
+        }
+        if (!files::rename_path(staging, directory)) {
+            // Another process extracted the same bundle first
+            files::remove_all(staging);
+            if (!files::is_directory(directory)) {
+                BNB_LOG_WARNING("Failed to move extracted effect bundle to " << directory);
+                return effect;
+            }
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        BNB_LOG_INFO("Effect bundle " << bundle_path << " extracted in " << elapsed.count() << " ms");
+        return directory;
+    }
+} // bnb
@@ -0,0 +1,61 @@
+#include "i420_utils.hpp"
+
+#include <libyuv.h>
+
+namespace
+{
+    void bpc8_to_i420(const bnb::bpc8_image_t& image, const bnb::interfaces::image_rect& rect, bnb::i420::buffer& out)
+    {
+        using bnb::interfaces::pixel_format;
+
+        auto format = image.get_pixel_format();
+        int bpp = (format == pixel_format::rgb || format == pixel_format::bgr) ? 3 : 4;
+        int stride = int(image.get_format().width) * bpp;
+        const uint8_t* src = image.get_data() + rect.y * stride + rect.x * bpp;
+
+        // libyuv names formats by little-endian word order, e.g. ABGR is R,G,B,A in memory
+        auto convert = libyuv::ABGRToI420;
+        switch (format) {
+            // clang-format off
+            case pixel_format::rgb:  convert = libyuv::RAWToI420;   break;
+            case pixel_format::bgr:  convert = libyuv::RGB24ToI420; break;
+            case pixel_format::rgba: convert = libyuv::ABGRToI420;  break;
+            case pixel_format::bgra: convert = libyuv::ARGBToI420;  break;
+            case pixel_format::argb: convert = libyuv::BGRAToI420;  break;
+            // clang-format on
+        }
+        convert(src, stride, out.y, out.width, out.u, out.width / 2, out.v, out.width / 2, rect.width, rect.height);
+    }
+
+    void nv12_to_i420(const bnb::yuv_image_t& image, const bnb::interfaces::image_rect& rect, bnb::i420::buffer& out)
+    {
+        int stride = int(image.get_format().width);
+        const uint8_t* src_y = image.get_base_ptr_of_plane(0) + rect.y * stride + rect.x;
+        const uint8_t* src_uv = image.get_base_ptr_of_plane(1) + (rect.y / 2) * stride + rect.x;
+        libyuv::NV12ToI420(src_y, stride, src_uv, stride, out.y, out.width, out.u, out.width / 2, out.v, out.width / 2, rect.width, rect.height);
+    }
+} // namespace
+
+namespace bnb::i420
+{
+    void buffer::resize(int w, int h)
+    {
+        width = w;
+        height = h;
+        auto y_size = size_t(w) * h;
+        auto uv_size = size_t(w / 2) * (h / 2);
+        data.resize(y_size + uv_size * 2);
+        y = data.data();
+        u = y + y_size;
+        v = u + uv_size;
+    }
+
+    void from_image(const full_image_t& image, const interfaces::image_rect& rect, buffer& out)
+    {
+        if (image.has_data<yuv_image_t>()) {
+            nv12_to_i420(image.get_data<yuv_image_t>(), rect, out);
+        } else {
+            bpc8_to_i420(image.get_data<bpc8_image_t>(), rect, out);
+        }
+    }
+} // bnb::i420
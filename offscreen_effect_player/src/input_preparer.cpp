@@ -0,0 +1,77 @@
+#include "input_preparer.hpp"
+#include "i420_utils.hpp"
+
+#include <libyuv.h>
+
+#include <algorithm>
+
+namespace
+{
+    using bnb::i420::even;
+
+    bnb::interfaces::image_rect clamp_crop(const std::optional<bnb::interfaces::image_rect>& crop, int32_t width, int32_t height)
+    {
+        if (!crop.has_value()) {
+            return {0, 0, even(width), even(height)};
+        }
+        auto x = even(std::clamp(crop->x, 0, width - 2));
+        auto y = even(std::clamp(crop->y, 0, height - 2));
+        auto w = even(std::clamp(crop->width, 2, width - x));
+        auto h = even(std::clamp(crop->height, 2, height - y));
+        return {x, y, w, h};
+    }
+} // namespace
+
+namespace bnb
+{
+    input_preparer::input_preparer(plane_pool_sptr plane_pool)
+        : m_plane_pool(std::move(plane_pool)) {}
+
+    full_image_t input_preparer::prepare(const full_image_t& image, const std::optional<interfaces::image_rect>& crop,
+                                         uint32_t max_width, uint32_t max_height)
+    {
+        // Scratch buffers are reused between frames on each worker
+        thread_local i420::buffer cropped;
+        thread_local i420::buffer scaled;
+
+        auto format = image.get_format();
+        auto rect = clamp_crop(crop, int32_t(format.width), int32_t(format.height));
+
+        auto scale = 1.0;
+        if (max_width > 0 && max_height > 0) {
+            scale = std::min({1.0, double(max_width) / rect.width, double(max_height) / rect.height});
+        }
+        auto out_width = std::max(2, even(int32_t(rect.width * scale)));
+        auto out_height = std::max(2, even(int32_t(rect.height * scale)));
+
+        bool is_nv12 = image.has_data<yuv_image_t>();
+        bool is_whole = rect.width == int32_t(format.width) && rect.height == int32_t(format.height);
+        if (is_nv12 && is_whole && out_width == rect.width && out_height == rect.height) {
+            // Already in the render format, share the planes instead of copying
+            return image;
+        }
+
+        cropped.resize(rect.width, rect.height);
+        i420::from_image(image, rect, cropped);
+
+        auto* result = &cropped;
+        if (out_width != rect.width || out_height != rect.height) {
+            scaled.resize(out_width, out_height);
+            libyuv::I420Scale(cropped.y, cropped.width, cropped.u, cropped.width / 2, cropped.v, cropped.width / 2,
+                cropped.width, cropped.height,
+                scaled.y, scaled.width, scaled.u, scaled.width / 2, scaled.v, scaled.width / 2,
+                scaled.width, scaled.height, libyuv::kFilterBox);
+            result = &scaled;
+        }
+
+        auto y_plane = m_plane_pool->acquire(size_t(out_width) * out_height);
+        auto uv_plane = m_plane_pool->acquire(size_t(out_width) * (out_height / 2));
+        libyuv::I420ToNV12(result->y, result->width, result->u, result->width / 2, result->v, result->width / 2,
+            y_plane.get(), out_width, uv_plane.get(), out_width, out_width, out_height);
+
+        image_format out_format = format;
+        out_format.width = uint32_t(out_width);
+        out_format.height = uint32_t(out_height);
+        return full_image_t(yuv_image_t(y_plane, uv_plane, out_format));
+    }
+} // bnb
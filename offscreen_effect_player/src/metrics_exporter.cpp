@@ -0,0 +1,328 @@
+#include "metrics_exporter.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    using socket_t = SOCKET;
+    #define BNB_CLOSE_SOCKET closesocket
+#else
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+    #include <sys/select.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+    using socket_t = int;
+    #define BNB_CLOSE_SOCKET close
+#endif
+
+#ifdef MSG_NOSIGNAL
+    #define BNB_SEND_FLAGS MSG_NOSIGNAL
+#else
+    #define BNB_SEND_FLAGS 0
+#endif
+
+namespace
+{
+    struct metric_desc
+    {
+        const char* name;
+        const char* type;
+        const char* help;
+    };
+
+    // A client that connects and sends nothing must not block the exporter thread
+    constexpr int client_timeout_ms = 1000;
+
+    void set_client_options(socket_t client)
+    {
+#ifdef _WIN32
+        DWORD timeout = client_timeout_ms;
+#else
+        timeval timeout{client_timeout_ms / 1000, (client_timeout_ms % 1000) * 1000};
+#endif
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+        // No MSG_NOSIGNAL on macOS, a scraper closing early must not kill the process with SIGPIPE
+        int no_sigpipe = 1;
+        setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+    }
+
+    // Label values are quoted strings in the text format
+    std::string escape_label(const std::string& value)
+    {
+        std::string escaped;
+        escaped.reserve(value.size());
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+                escaped += c;
+            } else if (c == '\n') {
+                escaped += "\\n";
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    void write_header(std::ostream& out, const metric_desc& desc)
+    {
+        out << "# HELP " << desc.name << " " << desc.help << "\n";
+        out << "# TYPE " << desc.name << " " << desc.type << "\n";
+    }
+
+    template<typename Getter>
+    void write_metric(std::ostream& out,
+        const metric_desc& desc,
+        const std::vector<std::pair<std::string, bnb::interfaces::oep_metrics>>& instances,
+        Getter getter)
+    {
+        write_header(out, desc);
+        for (const auto& [name, metrics] : instances) {
+            out << desc.name << "{instance=\"" << name << "\"} " << getter(metrics) << "\n";
+        }
+    }
+} // namespace
+
+namespace bnb
+{
+    metrics_exporter::metrics_exporter(std::chrono::milliseconds period)
+        : m_period(period)
+        , m_file_thread([this]() { file_thread_func(); }) {}
+
+    metrics_exporter::~metrics_exporter()
+    {
+        m_stop = true;
+        m_cv.notify_all();
+        m_file_thread.join();
+        if (m_http_thread.joinable()) {
+            m_http_thread.join();
+        }
+        if (m_listen_socket != -1) {
+            BNB_CLOSE_SOCKET(static_cast<socket_t>(m_listen_socket));
+#ifdef _WIN32
+            WSACleanup();
+#endif
+        }
+    }
+
+    void metrics_exporter::add_instance(const std::string& name, const ioep_sptr& oep)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_instances[name] = oep;
+    }
+
+    void metrics_exporter::remove_instance(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_instances.erase(name);
+    }
+
+    void metrics_exporter::set_file(const std::string& path)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_file_path = path;
+        }
+        m_cv.notify_all();
+    }
+
+    std::string metrics_exporter::format()
+    {
+        std::vector<std::pair<std::string, interfaces::oep_metrics>> instances;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto it = m_instances.begin(); it != m_instances.end();) {
+                if (auto oep = it->second.lock()) {
+                    instances.emplace_back(escape_label(it->first), oep->get_metrics());
+                    ++it;
+                } else {
+                    it = m_instances.erase(it);
+                }
+            }
+        }
+
+        using m = interfaces::oep_metrics;
+        std::ostringstream out;
+
+        write_metric(out, {"oep_frames_submitted_total", "counter", "Frames passed to process_image_async."},
+            instances, [](const m& v) { return v.frames_submitted; });
+        write_metric(out, {"oep_frames_rendered_total", "counter", "Frames rendered and passed to the consumer."},
+            instances, [](const m& v) { return v.frames_rendered; });
+        write_metric(out, {"oep_frames_passthrough_total", "counter", "Rendered frames that bypassed the effect player."},
+            instances, [](const m& v) { return v.frames_passthrough; });
+
+        write_header(out, {"oep_frames_dropped_total", "counter", "Frames dropped before rendering by reason."});
+        for (const auto& [name, v] : instances) {
+            out << "oep_frames_dropped_total{instance=\"" << name << "\",reason=\"queue_busy\"} " << v.frames_dropped_queue_busy << "\n";
+            out << "oep_frames_dropped_total{instance=\"" << name << "\",reason=\"pixel_buffer_locked\"} " << v.frames_dropped_pb_locked << "\n";
+            out << "oep_frames_dropped_total{instance=\"" << name << "\",reason=\"draw_timeout\"} " << v.frames_dropped_draw_timeout << "\n";
+            out << "oep_frames_dropped_total{instance=\"" << name << "\",reason=\"deadline\"} " << v.frames_dropped_deadline << "\n";
+        }
+
+        write_metric(out, {"oep_queue_depth", "gauge", "Frames waiting for the render thread."},
+            instances, [](const m& v) { return v.queue_depth; });
+        write_metric(out, {"oep_pixel_buffers_in_flight", "gauge", "Locked pixel buffers."},
+            instances, [](const m& v) { return v.pixel_buffers_in_flight; });
+        write_metric(out, {"oep_read_back_bytes_total", "counter", "Bytes read back from GPU."},
+            instances, [](const m& v) { return v.bytes_read_back; });
+        write_metric(out, {"oep_conversions_total", "counter", "Output format conversions."},
+            instances, [](const m& v) { return v.conversions; });
+        write_metric(out, {"oep_conversion_seconds_total", "counter", "Time spent in output format conversions."},
+            instances, [](const m& v) { return double(v.conversion_time_us) / 1e6; });
+        write_metric(out, {"oep_allocations_avoided_total", "counter", "Output planes reused from the pool."},
+            instances, [](const m& v) { return v.allocations_avoided; });
+        write_metric(out, {"oep_effects_activated_total", "counter", "Effects loaded and activated."},
+            instances, [](const m& v) { return v.effects_activated; });
+        write_header(out, {"oep_effect_prefetch_requests_total", "counter", "Effect loads by whether effect files were already prefetched."});
+        for (const auto& [name, v] : instances) {
+            out << "oep_effect_prefetch_requests_total{instance=\"" << name << "\",result=\"hit\"} " << v.effect_prefetch_hits << "\n";
+            out << "oep_effect_prefetch_requests_total{instance=\"" << name << "\",result=\"miss\"} " << v.effect_prefetch_misses << "\n";
+        }
+        write_metric(out, {"oep_effect_swap_latency_seconds", "gauge", "Time from load request to activation of the last effect."},
+            instances, [](const m& v) { return double(v.last_effect_swap_latency_us) / 1e6; });
+        write_metric(out, {"oep_effect_warmup_seconds", "gauge", "Time spent rendering warm-up frames for the last effect."},
+            instances, [](const m& v) { return double(v.last_effect_warmup_us) / 1e6; });
+        write_metric(out, {"oep_frame_latency_seconds", "gauge", "Time from capture to delivery of the last rendered frame."},
+            instances, [](const m& v) { return double(v.last_frame_latency_us) / 1e6; });
+        write_metric(out, {"oep_time_to_first_frame_seconds", "gauge", "Time from creation of the instance to the first processed frame."},
+            instances, [](const m& v) { return double(v.time_to_first_frame_us) / 1e6; });
+        write_metric(out, {"oep_resolution_changes_total", "counter", "Changes of the processing resolution."},
+            instances, [](const m& v) { return v.resolution_changes; });
+        write_header(out, {"oep_shm_frames_total", "counter", "Frames offered to the shared memory output by result."});
+        for (const auto& [name, v] : instances) {
+            out << "oep_shm_frames_total{instance=\"" << name << "\",result=\"written\"} " << v.shm_frames_written << "\n";
+            out << "oep_shm_frames_total{instance=\"" << name << "\",result=\"skipped\"} " << v.shm_frames_skipped << "\n";
+        }
+        write_metric(out, {"oep_processing_width_pixels", "gauge", "Processing surface width, lowered by the resolution governor."},
+            instances, [](const m& v) { return v.processing_width; });
+        write_metric(out, {"oep_processing_height_pixels", "gauge", "Processing surface height, lowered by the resolution governor."},
+            instances, [](const m& v) { return v.processing_height; });
+
+        return out.str();
+    }
+
+    void metrics_exporter::file_thread_func()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop) {
+            m_cv.wait_for(lock, m_period, [this]() { return m_stop.load(); });
+            if (m_stop || m_file_path.empty()) {
+                continue;
+            }
+
+            auto path = m_file_path;
+            lock.unlock();
+
+            auto tmp_path = path + ".tmp";
+            {
+                std::ofstream file(tmp_path, std::ios::trunc);
+                file << format();
+            }
+            // Readers see either the previous or the new file, never a missing one
+#ifdef _WIN32
+            MoveFileExA(tmp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+            std::rename(tmp_path.c_str(), path.c_str());
+#endif
+
+            lock.lock();
+        }
+    }
+
+    bool metrics_exporter::listen(uint16_t port)
+    {
+        if (m_listen_socket != -1) {
+            return false;
+        }
+
+#ifdef _WIN32
+        WSADATA wsa_data;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+            return false;
+        }
+#endif
+
+        socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (s == socket_t(-1)) {
+#ifdef _WIN32
+            WSACleanup();
+#endif
+            return false;
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int reuse = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+        if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(s, 4) != 0) {
+            BNB_CLOSE_SOCKET(s);
+#ifdef _WIN32
+            WSACleanup();
+#endif
+            return false;
+        }
+
+        m_listen_socket = static_cast<intptr_t>(s);
+        m_http_thread = std::thread([this]() { http_thread_func(); });
+        return true;
+    }
+
+    void metrics_exporter::http_thread_func()
+    {
+        auto listen_socket = static_cast<socket_t>(m_listen_socket);
+
+        while (!m_stop) {
+            // Wake up periodically to check stop flag
+            fd_set fds;
+            FD_ZERO(&fds);
+            FD_SET(listen_socket, &fds);
+            timeval timeout{0, 200000};
+            if (select(int(listen_socket) + 1, &fds, nullptr, nullptr, &timeout) <= 0) {
+                continue;
+            }
+
+            socket_t client = accept(listen_socket, nullptr, nullptr);
+            if (client == socket_t(-1)) {
+                continue;
+            }
+
+            set_client_options(client);
+
+            // Whatever was requested, respond with metrics
+            char request[1024];
+            if (recv(client, request, sizeof(request), 0) <= 0) {
+                BNB_CLOSE_SOCKET(client);
+                continue;
+            }
+
+            auto body = format();
+            std::ostringstream response;
+            response << "HTTP/1.0 200 OK\r\n"
+                     << "Content-Type: text/plain; version=0.0.4\r\n"
+                     << "Content-Length: " << body.size() << "\r\n"
+                     << "Connection: close\r\n\r\n"
+                     << body;
+            auto data = response.str();
+            for (size_t sent = 0; sent < data.size();) {
+                auto n = send(client, data.data() + sent, int(data.size() - sent), BNB_SEND_FLAGS);
+                if (n <= 0) {
+                    break;
+                }
+                sent += size_t(n);
+            }
+            BNB_CLOSE_SOCKET(client);
+        }
+    }
+} // bnb
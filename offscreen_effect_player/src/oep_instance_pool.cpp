@@ -0,0 +1,221 @@
+#include "oep_instance_pool.hpp"
+
+#include "logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    constexpr auto rate_period = 1s;
+    // Extra idle instances are destroyed one by one, so short gaps between checkouts don't drain the pool
+    constexpr auto shrink_period = 30s;
+    constexpr double ewma_alpha = 0.3;
+} // namespace
+
+namespace bnb
+{
+    std::shared_ptr<oep_instance_pool> oep_instance_pool::create(oep_instance_pool_config config)
+    {
+        // we use "new" instead of "make_shared" because the constructor is private
+        return std::shared_ptr<oep_instance_pool>(new oep_instance_pool(std::move(config)));
+    }
+
+    oep_instance_pool::oep_instance_pool(oep_instance_pool_config config)
+        : m_config(std::move(config))
+        , m_target_idle(m_config.min_idle)
+        , m_period_start(std::chrono::steady_clock::now())
+        , m_last_shrink(m_period_start)
+    {
+        m_config.max_idle = std::max(m_config.max_idle, m_config.min_idle);
+        m_thread = std::thread([this]() { thread_func(); });
+    }
+
+    oep_instance_pool::~oep_instance_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    ioep_sptr oep_instance_pool::checkout()
+    {
+        ioep_sptr oep;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_checkouts_in_period;
+            if (!m_idle.empty()) {
+                oep = std::move(m_idle.back());
+                m_idle.pop_back();
+            }
+        }
+        m_cv.notify_all();
+
+        if (oep == nullptr) {
+            BNB_LOG_INFO("Offscreen effect player pool is empty, creating instance");
+            oep = create_instance();
+            if (oep == nullptr) {
+                return nullptr;
+            }
+        }
+
+        // Returns the instance to the pool instead of destroying it
+        std::weak_ptr<oep_instance_pool> pool = shared_from_this();
+        auto raw = oep.get();
+        return ioep_sptr(raw, [pool, oep](interfaces::offscreen_effect_player*) mutable {
+            if (auto pool_sp = pool.lock()) {
+                pool_sp->recycle(std::move(oep));
+            }
+        });
+    }
+
+    size_t oep_instance_pool::idle_count()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_idle.size();
+    }
+
+    size_t oep_instance_pool::target_idle_count()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_target_idle;
+    }
+
+    ioep_sptr oep_instance_pool::create_instance()
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        ioep_sptr oep;
+        try {
+            auto ort = m_config.ort_factory();
+            oep = interfaces::offscreen_effect_player::create(m_config.path_to_resources, m_config.client_token,
+                m_config.width, m_config.height, m_config.manual_audio, ort, m_config.render_workers);
+        }
+        catch (std::exception& e) {
+            BNB_LOG_ERROR("Failed to create pooled effect player: " << e.what());
+            return nullptr;
+        }
+
+        if (oep != nullptr) {
+            oep->set_effect_warmup_frames(m_config.warmup_frames);
+            if (!m_config.default_effect.empty()) {
+                oep->load_effect(m_config.default_effect);
+            }
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_creation_seconds = ewma_alpha * elapsed.count() + (1.0 - ewma_alpha) * m_creation_seconds;
+        return oep;
+    }
+
+    void oep_instance_pool::reset_instance(const ioep_sptr& oep)
+    {
+        // All calls are queued to the render thread of the instance and don't block
+        oep->set_input_preparation({});
+        oep->surface_changed(m_config.width, m_config.height);
+        oep->set_output_size(0, 0);
+        oep->set_output_layers({});
+        oep->set_resolution_governor({});
+        oep->set_scheduling_policy(interfaces::scheduling_policy::latency_first);
+        oep->set_pipelined_readback(false);
+        oep->set_shm_output(std::nullopt);
+        oep->resume();
+        if (m_config.default_effect.empty()) {
+            oep->unload_effect();
+        } else {
+            oep->load_effect(m_config.default_effect);
+        }
+    }
+
+    void oep_instance_pool::recycle(ioep_sptr oep)
+    {
+        reset_instance(oep);
+
+        // Frames and readbacks of the previous session must not reach the next one, the instance
+        // becomes idle once they are drained. Until then the pool keeps the reference, even extra
+        // instances are destroyed on the pool thread, not on the render thread of the instance itself
+        auto raw = oep.get();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_resetting.push_back(oep);
+        }
+        std::weak_ptr<oep_instance_pool> pool = shared_from_this();
+        oep->flush([pool, raw]() {
+            if (auto pool_sp = pool.lock()) {
+                pool_sp->on_reset(raw);
+            }
+        });
+    }
+
+    void oep_instance_pool::on_reset(interfaces::offscreen_effect_player* oep)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = std::find_if(m_resetting.begin(), m_resetting.end(),
+                [oep](const ioep_sptr& resetting) { return resetting.get() == oep; });
+            if (it == m_resetting.end()) {
+                return;
+            }
+            m_idle.push_back(std::move(*it));
+            m_resetting.erase(it);
+        }
+        m_cv.notify_all();
+    }
+
+    void oep_instance_pool::update_target(std::chrono::steady_clock::time_point now)
+    {
+        std::chrono::duration<double> elapsed = now - m_period_start;
+        if (elapsed < rate_period) {
+            return;
+        }
+
+        auto rate = m_checkouts_in_period / elapsed.count();
+        m_checkouts_per_second = ewma_alpha * rate + (1.0 - ewma_alpha) * m_checkouts_per_second;
+        m_checkouts_in_period = 0;
+        m_period_start = now;
+
+        // Instances checked out while a replacement is being created
+        auto demand = size_t(std::ceil(m_checkouts_per_second * m_creation_seconds));
+        m_target_idle = std::clamp(m_config.min_idle + demand, m_config.min_idle, m_config.max_idle);
+    }
+
+    void oep_instance_pool::thread_func()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop) {
+            auto now = std::chrono::steady_clock::now();
+            update_target(now);
+
+            if (m_idle.size() < m_target_idle) {
+                lock.unlock();
+                auto oep = create_instance();
+                lock.lock();
+                if (oep != nullptr) {
+                    m_idle.push_back(std::move(oep));
+                } else {
+                    m_cv.wait_for(lock, rate_period, [this]() { return m_stop; });
+                }
+                continue;
+            }
+
+            if (m_idle.size() > m_config.max_idle
+                || (m_idle.size() > m_target_idle && now - m_last_shrink > shrink_period)) {
+                auto extra = std::move(m_idle.front());
+                m_idle.erase(m_idle.begin());
+                m_last_shrink = now;
+                lock.unlock();
+                extra.reset();
+                lock.lock();
+                continue;
+            }
+
+            m_cv.wait_for(lock, rate_period);
+        }
+    }
+} // bnb
@@ -1,13 +1,88 @@
 #include "offscreen_effect_player.hpp"
 #include "offscreen_render_target.hpp"
 
-#include <iostream>
+#include "opengl.hpp"
+#include "logger.hpp"
+#include "tracer.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    // Effect player returns negative value from draw() until the pushed frame is processed
+    constexpr std::chrono::milliseconds draw_timeout{1000};
+    // Upper bound of warm-up including waiting for the effect activation
+    constexpr std::chrono::milliseconds warmup_timeout{10000};
+    // Frames being read on the readback thread while the render thread renders the next one
+    constexpr size_t published_ring_size = 3;
+
+    size_t input_worker_count()
+    {
+        return std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, 4);
+    }
+
+    // Output frames are converted to NV12, which needs even sizes. 0 is kept as "not set"
+    int32_t even_output_size(int32_t value)
+    {
+        return value > 0 ? std::max(2, bnb::i420::even(value)) : 0;
+    }
+
+    class activation_listener : public bnb::interfaces::effect_activation_completion_listener
+    {
+    public:
+        explicit activation_listener(std::function<void(const std::string&)> on_activated)
+            : m_on_activated(std::move(on_activated)) {}
+
+        void on_effect_activation_completed(const std::string& url) override
+        {
+            m_on_activated(url);
+        }
+
+    private:
+        std::function<void(const std::string&)> m_on_activated;
+    };
+
+    // Url reported by effect manager may be resolved to the full path, the requested path
+    // must be the whole of it or its last components, so "Afro" doesn't match ".../SuperAfro"
+    bool is_effect_url(const std::string& url, const std::string& path)
+    {
+        if (path.empty() || url.size() < path.size()
+            || url.compare(url.size() - path.size(), path.size(), path) != 0) {
+            return false;
+        }
+        auto prefix = url.size() - path.size();
+        return prefix == 0 || url[prefix - 1] == '/' || url[prefix - 1] == '\\';
+    }
+
+    // Input preparation is CPU bound, all instances share one pool sized by the CPU count
+    std::shared_ptr<bnb::thread_pool> shared_input_workers()
+    {
+        static std::mutex mutex;
+        static std::weak_ptr<bnb::thread_pool> instance;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto workers = instance.lock();
+        if (workers == nullptr) {
+            workers = std::make_shared<bnb::thread_pool>(input_worker_count());
+            instance = workers;
+        }
+        return workers;
+    }
+} // namespace
 
 namespace bnb
 {
     ioep_sptr interfaces::offscreen_effect_player::create(
         const std::vector<std::string>& path_to_resources, const std::string& client_token,
         int32_t width, int32_t height, bool manual_audio, iort_sptr ort)
+    {
+        return create(path_to_resources, client_token, width, height, manual_audio, ort, nullptr);
+    }
+
+    ioep_sptr interfaces::offscreen_effect_player::create(
+        const std::vector<std::string>& path_to_resources, const std::string& client_token,
+        int32_t width, int32_t height, bool manual_audio, iort_sptr ort,
+        std::shared_ptr<render_worker_pool> render_workers)
     {
         if (ort == nullptr) {
             return nullptr;
@@ -15,66 +90,141 @@ namespace bnb
 
         // we use "new" instead of "make_shared" because the constructor in "offscreen_effect_player" is private
         return oep_sptr(new bnb::offscreen_effect_player(
-                path_to_resources, client_token, width, height, manual_audio, ort));
+                path_to_resources, client_token, width, height, manual_audio, ort, render_workers),
+            [](bnb::offscreen_effect_player* oep) {
+                // The last reference may be released by a task running on a thread of the instance, e.g. a
+                // pixel buffer callback. The destructor waits for tasks on these threads and may join them,
+                // so it is run on a thread of its own then
+                if (oep->is_own_thread()) {
+                    std::thread([oep]() { delete oep; }).detach();
+                } else {
+                    delete oep;
+                }
+            });
     }
 
     offscreen_effect_player::offscreen_effect_player(
         const std::vector<std::string>& path_to_resources, const std::string& client_token,
         int32_t width, int32_t height, bool manual_audio,
-        iort_sptr offscreen_render_target)
-            : m_utility(path_to_resources, client_token)
+        iort_sptr offscreen_render_target, std::shared_ptr<render_worker_pool> render_workers)
+            : m_created_at(std::chrono::steady_clock::now())
+            , m_ort(offscreen_render_target)
+            , m_scheduler(render_workers != nullptr
+                ? render_workers->create_session()
+                : render_worker_pool::create(1, "oep_render")->create_session())
+            , m_render_target_ready(m_scheduler->enqueue([ort = m_ort]() {
+                BNB_TRACE_SCOPE_NO_FRAME("render_target_init");
+                ort->init();
+            }))
+            , m_utility(path_to_resources, client_token)
             , m_ep(bnb::interfaces::effect_player::create( {
                 width, height,
                 bnb::interfaces::nn_mode::automatically,
                 bnb::interfaces::face_search_mode::good,
                 false, manual_audio }))
-            , m_ort(offscreen_render_target)
-            , m_scheduler(1)
+            , m_metrics(std::make_shared<metrics_counters>())
+            , m_plane_pool(std::make_shared<plane_pool>(m_metrics))
+            , m_prefetch_tracker(prefetch_tracker::instance())
+            , m_resource_paths(path_to_resources)
+            , m_effect_prefetcher(effect_prefetcher::instance())
+            , m_input_workers(shared_input_workers())
+            , m_input_preparer(std::make_shared<plane_pool>(m_metrics, 8))
+            , m_surface_width(width)
+            , m_surface_height(height)
+            , m_processing_width(width)
+            , m_processing_height(height)
     {
+        m_metrics->processing_width.store(uint32_t(width), std::memory_order_relaxed);
+        m_metrics->processing_height.store(uint32_t(height), std::memory_order_relaxed);
+
+        auto sdk_ready = std::chrono::steady_clock::now();
+
         // MacOS GLFW requires window creation on main thread, so it is assumed that we are on main thread.
+        // Render target is initialized by the time this task runs, it was queued first
         auto task = [this, width, height]() {
-            render_thread_id = std::this_thread::get_id();
-            m_ort->init();
             m_ort->activate_context();
             m_ep->surface_created(width, height);
+
+            m_activation_listener = std::make_shared<activation_listener>(
+                [this](const std::string& url) { on_effect_activated(url); });
+            m_ep->effect_manager()->add_effect_activation_completion_listener(m_activation_listener);
 #ifdef WIN32 // Only necessary if we want share context via GLFW on Windows
             m_ort->deactivate_context();
 #endif
         };
 
-        auto future = m_scheduler.enqueue(task);
+        auto future = m_scheduler->enqueue(task);
         try {
-            // Wait result of task since initialization of glad can cause exceptions if proceed without
+            // Wait result of tasks since initialization of glad can cause exceptions if proceed without
+            m_render_target_ready.get();
             future.get();
         }
         catch (std::runtime_error& e) {
-            std::cout << "[ERROR] Failed to initialize effect player: " << e.what() << std::endl;
+            BNB_LOG_ERROR("Failed to initialize effect player: " << e.what());
             throw std::runtime_error("Failed to initialize effect player.");
         }
+
+        if (m_ort->has_readback_context()) {
+            m_readback_scheduler = render_worker_pool::create(1, "oep_readback")->create_session();
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto ms = [](auto d) { return std::chrono::duration_cast<std::chrono::milliseconds>(d).count(); };
+        BNB_LOG_INFO("Effect player initialized in " << ms(now - m_created_at) << " ms (SDK "
+            << ms(sdk_ready - m_created_at) << " ms, render target in parallel)");
+    }
+
+    bool offscreen_effect_player::is_own_thread() const
+    {
+        return m_scheduler->is_worker_thread()
+            || (m_readback_scheduler != nullptr && m_readback_scheduler->is_worker_thread());
     }
 
     offscreen_effect_player::~offscreen_effect_player()
     {
+        // Finish preparation of queued frames, so no render task is enqueued after deinit
+        {
+            std::unique_lock<std::mutex> lock(m_preparation_mutex);
+            m_preparation_cv.wait(lock, [this]() { return m_pending_preparations == 0; });
+        }
+
         m_ep->surface_destroyed();
-        // Deinitialize offscreen render target, should be performed on render thread.
         auto task = [this]() {
-            m_ort->deinit();
+            if (auto e_manager = m_ep->effect_manager()) {
+                e_manager->remove_effect_activation_completion_listener(m_activation_listener);
+            }
         };
-        m_scheduler.enqueue(task).get();
+        m_scheduler->enqueue(task).get();
+
+        // Rendered frames are all handed over by now, published textures are released after they are read
+        if (m_readback_scheduler != nullptr) {
+            m_readback_scheduler->enqueue([this]() { m_ort->deinit_readback_context(); }).get();
+        }
+
+        // Deinitialize offscreen render target, should be performed on render thread.
+        m_scheduler->enqueue([this]() { m_ort->deinit(); }).get();
     }
 
     void offscreen_effect_player::process_image_async(std::shared_ptr<full_image_t> image, oep_pb_ready_cb callback,
                                                       std::optional<interfaces::orient_format> target_orient)
     {
-        if (m_current_frame == nullptr) {
-            m_current_frame = std::make_shared<pixel_buffer>(shared_from_this(),
-                image->get_format().width, image->get_format().height, image->get_format().orientation);
-        }
+        process_image_async(image, callback, target_orient, {std::chrono::steady_clock::now()});
+    }
 
-        if (m_current_frame->is_locked()) {
-#ifdef DEBUG
-            std::cout << "[Warning] The interface for processing the previous frame is lock" << std::endl;
-#endif
+    void offscreen_effect_player::process_image_async(std::shared_ptr<full_image_t> image, oep_pb_ready_cb callback,
+                                                      std::optional<interfaces::orient_format> target_orient,
+                                                      const interfaces::frame_timing& timing)
+    {
+        auto frame_id = ++m_frame_counter;
+        BNB_TRACE_INSTANT("submit", frame_id);
+        m_metrics->frames_submitted.fetch_add(1, std::memory_order_relaxed);
+
+        auto pb = ensure_pixel_buffer(image->get_format().orientation);
+
+        if (pb->is_locked()) {
+            BNB_TRACE_INSTANT("drop_pb_locked", frame_id);
+            m_metrics->frames_dropped_pb_locked.fetch_add(1, std::memory_order_relaxed);
+            BNB_LOG_DEBUG("The interface for processing the previous frame is lock");
             return;
         }
 
@@ -82,57 +232,717 @@ namespace bnb
             target_orient = { image->get_format().orientation, true };
         }
 
-        auto task = [this, image, callback, target_orient]() {
-            if (m_incoming_frame_queue_task_count == 1) {
-                m_current_frame->lock();
+        {
+            std::lock_guard<std::mutex> lock(m_preparation_mutex);
+            ++m_pending_preparations;
+        }
+        prepare_and_render(image, callback, *target_orient, frame_id, timing);
+    }
+
+    void offscreen_effect_player::prepare_and_render(std::shared_ptr<full_image_t> image, oep_pb_ready_cb callback,
+                                                     interfaces::orient_format target_orient, uint64_t frame_id,
+                                                     const interfaces::frame_timing& timing)
+    {
+        auto prepare_task = [this, image, callback, target_orient, frame_id, timing]() {
+            // Frames that are already late are not converted, render_frame reports the drop
+            std::shared_ptr<full_image_t> prepared;
+            if (!misses_deadline(timing)) {
+                prepared = std::make_shared<full_image_t>(prepare_input(*image, frame_id));
+            }
+
+            auto task = [this, prepared, callback, target_orient, frame_id, timing]() {
+                render_frame(prepared, callback, target_orient, frame_id, timing);
+            };
+            // Counted only once prepared, so a preparation slower than the camera interval
+            // doesn't make every frame look like it has a newer one queued behind it
+            ++m_incoming_frame_queue_task_count;
+            m_scheduler->enqueue(task);
+            finish_preparation();
+        };
+
+        m_input_workers->enqueue(prepare_task);
+    }
+
+    void offscreen_effect_player::finish_preparation()
+    {
+        std::lock_guard<std::mutex> lock(m_preparation_mutex);
+        if (--m_pending_preparations == 0) {
+            m_preparation_cv.notify_all();
+        }
+    }
+
+    void offscreen_effect_player::process_texture_async(int32_t texture_id, interfaces::oep_sync fence,
+                                                        int32_t width, int32_t height, camera_orientation orientation,
+                                                        oep_pb_ready_cb callback,
+                                                        std::optional<interfaces::orient_format> target_orient)
+    {
+        process_texture_async(texture_id, fence, width, height, orientation, callback, target_orient,
+                              {std::chrono::steady_clock::now()});
+    }
+
+    void offscreen_effect_player::process_texture_async(int32_t texture_id, interfaces::oep_sync fence,
+                                                        int32_t width, int32_t height, camera_orientation orientation,
+                                                        oep_pb_ready_cb callback,
+                                                        std::optional<interfaces::orient_format> target_orient,
+                                                        const interfaces::frame_timing& timing)
+    {
+        auto frame_id = ++m_frame_counter;
+        BNB_TRACE_INSTANT("submit_texture", frame_id);
+        m_metrics->frames_submitted.fetch_add(1, std::memory_order_relaxed);
+
+        auto pb = ensure_pixel_buffer(orientation);
+
+        if (pb->is_locked()) {
+            BNB_TRACE_INSTANT("drop_pb_locked", frame_id);
+            m_metrics->frames_dropped_pb_locked.fetch_add(1, std::memory_order_relaxed);
+            BNB_LOG_DEBUG("The interface for processing the previous frame is lock");
+            return;
+        }
+
+        if (!target_orient.has_value()) {
+            target_orient = { orientation, true };
+        }
+
+        // Counted from submission, the readback result is prepared like an image frame
+        {
+            std::lock_guard<std::mutex> lock(m_preparation_mutex);
+            ++m_pending_preparations;
+        }
 
+        auto task = [this, texture_id, fence, width, height, orientation, callback, target_orient, frame_id, timing]() {
+            std::shared_ptr<full_image_t> image;
+            // The counter only grows outside of the render thread, a frame skipped here is dropped by render_frame
+            if (can_render(frame_id, timing)) {
+                BNB_TRACE_SCOPE("input_texture_readback", frame_id);
                 m_ort->activate_context();
-                m_ort->prepare_rendering();
-                m_ep->push_frame(std::move(*image));
-                while (m_ep->draw() < 0) {
-                    std::this_thread::yield();
+                // Effect player accepts CPU frames only, the texture is read on the render thread
+                // where it is already resident, instead of a round trip through the caller
+                auto data = m_ort->read_texture(texture_id, fence, width, height);
+                if (data.size != 0) {
+                    color_plane plane(data.data.release(), std::default_delete<uint8_t[]>());
+                    image_format format(uint32_t(width), uint32_t(height), orientation, false, 0, std::nullopt);
+                    image = std::make_shared<full_image_t>(bpc8_image_t(plane, interfaces::pixel_format::rgba, format));
+                } else {
+                    BNB_LOG_WARNING("Render target doesn't support texture input");
                 }
-                m_ort->orient_image(*target_orient);
-                callback(m_current_frame);
-                m_current_frame->unlock();
-            } else {
-                callback(std::nullopt);
+            } else if (fence != nullptr) {
+                m_ort->activate_context();
+                GL_CALL(glDeleteSync(static_cast<GLsync>(fence)));
+            }
+            if (image == nullptr) {
+                // Reports the drop
+                render_frame(image, callback, *target_orient, frame_id, timing);
+                finish_preparation();
+                return;
             }
+
+            // Crop, max size and processing size apply to texture frames as well, the readback
+            // is converted on the input workers and comes back to the render thread prepared
             --m_incoming_frame_queue_task_count;
+            prepare_and_render(image, callback, *target_orient, frame_id, timing);
         };
 
         ++m_incoming_frame_queue_task_count;
-        m_scheduler.enqueue(task);
+        m_scheduler->enqueue(task);
+    }
+
+    void offscreen_effect_player::set_scheduling_policy(interfaces::scheduling_policy policy)
+    {
+        m_scheduling_policy = policy;
+    }
+
+    void offscreen_effect_player::set_pipelined_readback(bool enabled)
+    {
+        if (enabled && m_readback_scheduler == nullptr) {
+            BNB_LOG_WARNING("Render target has no readback context, frames are read back on the render thread");
+            return;
+        }
+        m_pipelined_readback = enabled;
+    }
+
+    bool offscreen_effect_player::misses_deadline(const interfaces::frame_timing& timing) const
+    {
+        if (!timing.deadline.has_value()) {
+            return false;
+        }
+        auto estimate = std::chrono::microseconds(m_render_time_estimate_us.load(std::memory_order_relaxed));
+        return std::chrono::steady_clock::now() + estimate > *timing.deadline;
+    }
+
+    bool offscreen_effect_player::can_render(uint64_t frame_id, const interfaces::frame_timing& timing) const
+    {
+        if (frame_id <= m_last_rendered_frame_id || misses_deadline(timing)) {
+            return false;
+        }
+        // With latency first policy a frame is rendered only if no newer frame is queued behind it
+        return m_scheduling_policy == interfaces::scheduling_policy::throughput_first
+            || m_incoming_frame_queue_task_count == 1;
+    }
+
+    bool offscreen_effect_player::set_shm_output(const std::optional<interfaces::shm_output_config>& config)
+    {
+#ifdef _WIN32
+        if (config.has_value()) {
+            BNB_LOG_ERROR("Shared memory output is not available on Windows");
+            return false;
+        }
+        return true;
+#else
+        std::unique_ptr<shm::frame_writer> writer;
+        if (config.has_value()) {
+            int32_t width = even_output_size(config->max_width);
+            int32_t height = even_output_size(config->max_height);
+            if (width <= 0 || height <= 0) {
+                std::lock_guard<std::mutex> lock(m_input_mutex);
+                width = even_output_size(m_output_width > 0 ? m_output_width : m_surface_width);
+                height = even_output_size(m_output_height > 0 ? m_output_height : m_surface_height);
+            }
+            writer = shm::frame_writer::create(config->name, std::max<uint32_t>(config->slots, 1),
+                uint32_t(pixel_buffer::nv12_size(width, height)));
+            if (writer == nullptr) {
+                BNB_LOG_ERROR("Failed to create shared memory output " << config->name);
+                return false;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_shm_output_mutex);
+        m_shm_output = std::move(writer);
+        return true;
+#endif
+    }
+
+    void offscreen_effect_player::write_shm_output(const std::shared_ptr<pixel_buffer>& pb, uint64_t frame_id,
+                                                   const interfaces::frame_timing& timing)
+    {
+#ifndef _WIN32
+        std::lock_guard<std::mutex> lock(m_shm_output_mutex);
+        if (m_shm_output == nullptr) {
+            return;
+        }
+
+        BNB_TRACE_SCOPE("shm_output", frame_id);
+        shm::frame_info info{};
+        auto size = pb->write_nv12(m_shm_output->begin_frame(), m_shm_output->slot_size(), info.width, info.height);
+        if (size == 0) {
+            m_shm_output->abort_frame();
+            m_metrics->shm_frames_skipped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        info.frame_id = frame_id;
+        info.size = uint32_t(size);
+        info.capture_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            timing.capture_time.time_since_epoch()).count();
+        m_shm_output->commit_frame(info);
+        m_metrics->shm_frames_written.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    std::shared_ptr<pixel_buffer> offscreen_effect_player::ensure_pixel_buffer(camera_orientation orientation)
+    {
+        std::lock_guard<std::mutex> lock(m_current_frame_mutex);
+        if (m_current_frame == nullptr) {
+            m_current_frame = make_pixel_buffer(orientation);
+        }
+        return std::static_pointer_cast<pixel_buffer>(m_current_frame);
+    }
+
+    std::shared_ptr<pixel_buffer> offscreen_effect_player::current_frame()
+    {
+        std::lock_guard<std::mutex> lock(m_current_frame_mutex);
+        return std::static_pointer_cast<pixel_buffer>(m_current_frame);
+    }
+
+    void offscreen_effect_player::reset_current_frame()
+    {
+        std::lock_guard<std::mutex> lock(m_current_frame_mutex);
+        m_current_frame.reset();
+    }
+
+    std::shared_ptr<pixel_buffer> offscreen_effect_player::acquire_published_buffer(camera_orientation orientation)
+    {
+        if (m_published_frames.empty()) {
+            m_published_frames.resize(published_ring_size);
+        }
+        // Locked until the readback thread delivers it, or longer by the consumer. The render target
+        // reallocates the texture of the slot on publish, so a pixel buffer of an old output size
+        // is replaced only once it is unlocked too
+        auto& slot = m_published_frames[m_next_published_slot];
+        if (slot.pb != nullptr && slot.pb->is_locked()) {
+            return nullptr;
+        }
+        if (slot.pb == nullptr || slot.generation != m_output_generation) {
+            slot.pb = make_pixel_buffer(orientation);
+            slot.generation = m_output_generation;
+        }
+        return slot.pb;
+    }
+
+    std::shared_ptr<pixel_buffer> offscreen_effect_player::make_pixel_buffer(camera_orientation orientation)
+    {
+        // Pixel buffer has the size of the image read back from the render target, not of the input
+        int32_t width = 0;
+        int32_t height = 0;
+        std::vector<interfaces::output_layer> layers;
+        {
+            std::lock_guard<std::mutex> lock(m_input_mutex);
+            width = even_output_size(m_output_width > 0 ? m_output_width : m_surface_width);
+            height = even_output_size(m_output_height > 0 ? m_output_height : m_surface_height);
+            layers = m_output_layers;
+        }
+        return std::make_shared<pixel_buffer>(shared_from_this(), width, height, orientation, std::move(layers));
+    }
+
+    full_image_t offscreen_effect_player::prepare_input(const full_image_t& image, uint64_t frame_id)
+    {
+        BNB_TRACE_SCOPE("prepare_input", frame_id);
+
+        std::optional<interfaces::image_rect> crop;
+        uint32_t max_width = 0;
+        uint32_t max_height = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_input_mutex);
+            crop = m_input_preparation.crop;
+            // Frames larger than the processing size would be downscaled by the effect player anyway
+            max_width = uint32_t(m_input_preparation.max_width > 0
+                ? std::min(m_input_preparation.max_width, m_processing_width) : m_processing_width);
+            max_height = uint32_t(m_input_preparation.max_height > 0
+                ? std::min(m_input_preparation.max_height, m_processing_height) : m_processing_height);
+        }
+
+        return m_input_preparer.prepare(image, crop, max_width, max_height);
+    }
+
+    void offscreen_effect_player::render_frame(std::shared_ptr<full_image_t> image, oep_pb_ready_cb callback,
+                                               interfaces::orient_format target_orient, uint64_t frame_id,
+                                               const interfaces::frame_timing& timing)
+    {
+        BNB_TRACE_SCOPE("render_frame", frame_id);
+        if (image != nullptr && can_render(frame_id, timing)) {
+            bool pipelined = m_pipelined_readback.load();
+            auto pb = pipelined ? acquire_published_buffer(image->get_format().orientation)
+                                : current_frame();
+            if (pb == nullptr) {
+                // All frames of the ring are still being read, or the pixel buffer is being recreated
+                BNB_TRACE_INSTANT("drop_pb_locked", frame_id);
+                m_metrics->frames_dropped_pb_locked.fetch_add(1, std::memory_order_relaxed);
+                callback(std::nullopt);
+                --m_incoming_frame_queue_task_count;
+                return;
+            }
+
+            m_last_rendered_frame_id = frame_id;
+            pb->lock();
+            pb->set_frame_id(frame_id);
+            pb->set_frame_timing(timing);
+            pb->set_published(std::nullopt);
+
+            auto render_start = std::chrono::steady_clock::now();
+            bool rendered = true;
+            std::optional<interfaces::published_frame> published;
+            if (m_passthrough) {
+                // Nothing to draw, the consumer gets the input converted on the CPU on request
+                BNB_TRACE_SCOPE("passthrough", frame_id);
+                pb->set_passthrough(passthrough::frame{image, target_orient});
+                m_metrics->frames_passthrough.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                pb->set_passthrough(std::nullopt);
+                m_ort->activate_context();
+                m_ort->prepare_rendering();
+                {
+                    BNB_GL_SCOPE("push_frame");
+                    m_ep->push_frame(std::move(*image));
+                }
+                rendered = draw_frame();
+                if (rendered) {
+                    m_ort->orient_image(target_orient);
+                    if (pipelined) {
+                        published = m_ort->publish_frame(m_next_published_slot);
+                    }
+                } else {
+                    BNB_LOG_WARNING("Effect player draw timeout");
+                    BNB_TRACE_INSTANT("drop_draw_timeout", frame_id);
+                    m_metrics->frames_dropped_draw_timeout.fetch_add(1, std::memory_order_relaxed);
+                    callback(std::nullopt);
+                }
+            }
+            // Only the rendering is measured, the consumer callback of the non-pipelined path is not ours to throttle
+            auto render_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - render_start);
+
+            if (rendered && pipelined) {
+                m_next_published_slot = (m_next_published_slot + 1) % published_ring_size;
+                // Readback and conversion of this frame overlap with rendering of the next one
+                m_readback_scheduler->enqueue([this, pb, published, callback, frame_id, timing]() mutable {
+                    BNB_TRACE_SCOPE("readback_frame", frame_id);
+                    if (published.has_value()) {
+                        m_ort->wait_published(*published);
+                    }
+                    pb->set_published(published);
+                    deliver_frame(pb, callback, frame_id, timing);
+                    pb->unlock();
+                });
+            } else {
+                if (rendered) {
+                    deliver_frame(pb, callback, frame_id, timing);
+                }
+                pb->unlock();
+            }
+            report_render_stages();
+
+            auto estimate = m_render_time_estimate_us.load(std::memory_order_relaxed);
+            estimate = estimate == 0 ? render_time.count() : (render_time.count() + 7 * estimate) / 8;
+            m_render_time_estimate_us.store(estimate, std::memory_order_relaxed);
+            // Passthrough frames say nothing about the effect rendering cost
+            if (!m_passthrough) {
+                if (auto scale = m_governor.on_frame(render_time)) {
+                    apply_processing_scale(*scale);
+                }
+            }
+        } else if (misses_deadline(timing)) {
+            BNB_TRACE_INSTANT("drop_deadline", frame_id);
+            m_metrics->frames_dropped_deadline.fetch_add(1, std::memory_order_relaxed);
+            callback(std::nullopt);
+        } else {
+            BNB_TRACE_INSTANT("drop_queue_busy", frame_id);
+            m_metrics->frames_dropped_queue_busy.fetch_add(1, std::memory_order_relaxed);
+            callback(std::nullopt);
+        }
+        --m_incoming_frame_queue_task_count;
+    }
+
+    void offscreen_effect_player::deliver_frame(const std::shared_ptr<pixel_buffer>& pb, const oep_pb_ready_cb& callback,
+                                                uint64_t frame_id, const interfaces::frame_timing& timing)
+    {
+        // Before the callback, the other process doesn't wait for the in-process consumer
+        write_shm_output(pb, frame_id, timing);
+
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - timing.capture_time);
+        m_metrics->last_frame_latency_us.store(latency.count(), std::memory_order_relaxed);
+        {
+            BNB_TRACE_SCOPE("pb_ready_callback", frame_id);
+            callback(pb);
+        }
+        m_metrics->frames_rendered.fetch_add(1, std::memory_order_relaxed);
+        if (!m_first_frame_rendered.exchange(true)) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - m_created_at);
+            m_metrics->time_to_first_frame_us.store(elapsed.count(), std::memory_order_relaxed);
+            BNB_LOG_INFO("First frame processed " << elapsed.count() / 1000 << " ms after creation");
+        }
     }
 
     void offscreen_effect_player::surface_changed(int32_t width, int32_t height)
     {
-        auto task = [this, width, height]() {
+        {
+            std::lock_guard<std::mutex> lock(m_input_mutex);
+            m_surface_width = width;
+            m_surface_height = height;
+        }
+
+        auto task = [this]() {
+            reset_current_frame();
+            ++m_output_generation;
+            // The new surface is processed at the largest allowed scale
+            m_governor.reset();
+            apply_processing_scale(m_governor.scale());
+        };
+
+        m_scheduler->enqueue(task);
+    }
+
+    void offscreen_effect_player::set_output_size(int32_t width, int32_t height)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_input_mutex);
+            m_output_width = even_output_size(width);
+            m_output_height = even_output_size(height);
+        }
+
+        auto task = [this]() {
             m_ort->activate_context();
+            update_render_target_output();
+            reset_current_frame();
+            ++m_output_generation;
+        };
 
-            m_ep->surface_changed(width, height);
-            m_ep->effect_manager()->set_effect_size(width, height);
+        m_scheduler->enqueue(task);
+    }
 
-            m_current_frame.reset();
-            m_ort->surface_changed(width, height);
+    void offscreen_effect_player::set_output_layers(const std::vector<interfaces::output_layer>& output_layers)
+    {
+        auto layers = output_layers;
+        for (auto& layer : layers) {
+            layer.width = std::max(2, even_output_size(layer.width));
+            layer.height = std::max(2, even_output_size(layer.height));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_input_mutex);
+            m_output_layers = layers;
+        }
+
+        auto task = [this, layers]() {
+            m_ort->set_output_layers(layers);
+            reset_current_frame();
+            ++m_output_generation;
         };
 
-        m_scheduler.enqueue(task);
+        m_scheduler->enqueue(task);
+    }
+
+    void offscreen_effect_player::set_resolution_governor(const interfaces::resolution_governor_config& config)
+    {
+        auto task = [this, config]() {
+            m_governor.set_config(config);
+            apply_processing_scale(m_governor.scale());
+        };
+
+        m_scheduler->enqueue(task);
+    }
+
+    void offscreen_effect_player::apply_processing_scale(float scale)
+    {
+        int32_t width = 0;
+        int32_t height = 0;
+        bool changed = false;
+        {
+            std::lock_guard<std::mutex> lock(m_input_mutex);
+            // Even sizes keep NV12 chroma planes aligned
+            width = std::max(2, int32_t(m_surface_width * scale) & ~1);
+            height = std::max(2, int32_t(m_surface_height * scale) & ~1);
+            changed = width != m_processing_width || height != m_processing_height;
+            m_processing_width = width;
+            m_processing_height = height;
+        }
+
+        m_ort->activate_context();
+        m_ep->surface_changed(width, height);
+        m_ep->effect_manager()->set_effect_size(width, height);
+        m_ort->surface_changed(width, height);
+        update_render_target_output();
+
+        m_metrics->processing_width.store(uint32_t(width), std::memory_order_relaxed);
+        m_metrics->processing_height.store(uint32_t(height), std::memory_order_relaxed);
+        if (changed) {
+            m_metrics->resolution_changes.fetch_add(1, std::memory_order_relaxed);
+            BNB_LOG_INFO("Processing resolution " << width << "x" << height << ", scale " << scale);
+        }
+    }
+
+    void offscreen_effect_player::update_render_target_output()
+    {
+        int32_t width = 0;
+        int32_t height = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_input_mutex);
+            // Processing size may be lowered by the governor, consumers keep getting the surface size
+            width = even_output_size(m_output_width != 0 ? m_output_width : m_surface_width);
+            height = even_output_size(m_output_height != 0 ? m_output_height : m_surface_height);
+        }
+        m_ort->set_output_size(width, height);
+    }
+
+    void offscreen_effect_player::set_input_preparation(const interfaces::input_preparation& preparation)
+    {
+        std::lock_guard<std::mutex> lock(m_input_mutex);
+        m_input_preparation = preparation;
     }
 
     void offscreen_effect_player::load_effect(const std::string& effect_path)
     {
-        auto task = [this, effect = effect_path]() {
-            m_ort->activate_context();
+        load_effect(effect_path, nullptr);
+    }
 
-            if (auto e_manager = m_ep->effect_manager()) {
-                e_manager->load(effect);
+    void offscreen_effect_player::load_effect(const std::string& effect_path, oep_effect_activated_cb callback)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (!effect_path.empty()) {
+            if (m_prefetch_tracker->prefetched(effect_path)) {
+                m_metrics->effect_prefetch_hits.fetch_add(1, std::memory_order_relaxed);
             } else {
-                std::cout << "[Error] effect manager not initialized" << std::endl;
+                m_metrics->effect_prefetch_misses.fetch_add(1, std::memory_order_relaxed);
+                prefetch_effect(effect_path);
             }
-        };
+        }
+
+        // Only the latest request is loaded, an earlier one may still wait for its bundle extraction
+        auto generation = ++m_effect_generation;
+        std::weak_ptr<offscreen_effect_player> this_ = shared_from_this();
+        // Extraction of a bundle doesn't hold the render thread, the task is queued once the path is known
+        m_effect_prefetcher->resolve(effect_path, m_resource_paths,
+            [this_, scheduler = m_scheduler, effect = effect_path, callback, start, generation](const std::string& path) {
+                scheduler->enqueue([this_, effect, path, callback, start, generation]() {
+                    if (auto this_sp = this_.lock()) {
+                        this_sp->load_resolved_effect(effect, path, callback, start, generation);
+                    }
+                });
+            });
+    }
+
+    void offscreen_effect_player::load_resolved_effect(const std::string& effect, const std::string& path,
+                                                       const oep_effect_activated_cb& callback,
+                                                       std::chrono::steady_clock::time_point start, uint64_t generation)
+    {
+        if (generation != m_effect_generation) {
+            BNB_LOG_INFO("Effect " << effect << " is replaced by a later load_effect before loading");
+            return;
+        }
+
+        m_ort->activate_context();
+
+        auto e_manager = m_ep->effect_manager();
+        if (!e_manager) {
+            BNB_LOG_ERROR("effect manager not initialized");
+            return;
+        }
+
+        // Frames are pushed to the effect player while the new effect is loading, it is activated in draw
+        m_passthrough = effect.empty();
+        if (effect.empty()) {
+            // Nothing to load, the current effect is simply dropped
+            e_manager->load(effect);
+            if (callback) {
+                callback(effect);
+            }
+            return;
+        }
+
+        // Path differs from the effect only if it is extracted from a bundle
+        {
+            std::lock_guard<std::mutex> lock(m_effect_requests_mutex);
+            m_effect_requests.push_back({path, effect, start, callback});
+        }
+        // Resources are parsed in background, the current effect is drawn until the new one is activated
+        e_manager->load_async(path);
+
+        if (auto frames = m_effect_warmup_frames.load()) {
+            warm_up_effect(path, frames);
+        }
+    }
+
+    bool offscreen_effect_player::draw_frame()
+    {
+        BNB_GL_SCOPE("effect_draw");
+        auto draw_start = std::chrono::steady_clock::now();
+        while (m_ep->draw() < 0) {
+            if (std::chrono::steady_clock::now() - draw_start > draw_timeout) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    bool offscreen_effect_player::is_effect_pending(const std::string& effect)
+    {
+        std::lock_guard<std::mutex> lock(m_effect_requests_mutex);
+        return std::any_of(m_effect_requests.begin(), m_effect_requests.end(),
+            [&effect](const effect_load_request& r) { return r.path == effect; });
+    }
 
-        m_scheduler.enqueue(task);
+    void offscreen_effect_player::warm_up_effect(const std::string& effect, uint32_t frames)
+    {
+        int32_t width = 0;
+        int32_t height = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_input_mutex);
+            width = m_processing_width;
+            height = m_processing_height;
+        }
+
+        // Mid gray NV12 frame, the effect sees a frame without faces
+        auto y_plane = color_plane_vector(std::vector<uint8_t>(size_t(width) * height, 128));
+        auto uv_plane = color_plane_vector(std::vector<uint8_t>(size_t(width) * (height / 2), 128));
+        auto frame = std::make_shared<full_image_t>(yuv_image_t(y_plane, uv_plane,
+            image_format(uint32_t(width), uint32_t(height), camera_orientation::deg_0, false, 0, std::nullopt)));
+
+        render_warmup_frame(frame, effect, frames, std::chrono::steady_clock::now());
+    }
+
+    void offscreen_effect_player::render_warmup_frame(const std::shared_ptr<full_image_t>& frame, const std::string& effect,
+                                                      uint32_t frames, std::chrono::steady_clock::time_point start)
+    {
+        auto pb = current_frame();
+        if (pb != nullptr && pb->is_locked()) {
+            // Render target content is still being read by the consumer
+            BNB_LOG_WARNING("Skip warm-up of " << effect << ", pixel buffer is locked");
+            return;
+        }
+        if (std::chrono::steady_clock::now() - start > warmup_timeout) {
+            BNB_LOG_WARNING("Warm-up of " << effect << " timed out, " << frames << " frames left");
+            return;
+        }
+
+        {
+            BNB_TRACE_SCOPE_NO_FRAME("effect_warmup_frame");
+            m_ort->activate_context();
+            m_ort->prepare_rendering();
+            m_ep->push_frame(*frame);
+            if (!draw_frame()) {
+                return;
+            }
+        }
+
+        // Frames drawn before activation still show the previous effect and are not counted
+        if (!is_effect_pending(effect) && --frames == 0) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+            m_metrics->last_effect_warmup_us.store(elapsed.count(), std::memory_order_relaxed);
+            BNB_LOG_INFO("Effect " << effect << " warmed up in " << elapsed.count() / 1000 << " ms");
+            return;
+        }
+
+        // Queued behind the tasks already waiting, the instance may be destroyed by then
+        std::weak_ptr<offscreen_effect_player> this_ = shared_from_this();
+        m_scheduler->enqueue([this_, frame, effect, frames, start]() {
+            if (auto this_sp = this_.lock()) {
+                this_sp->render_warmup_frame(frame, effect, frames, start);
+            }
+        });
+    }
+
+    void offscreen_effect_player::on_effect_activated(const std::string& url)
+    {
+        std::vector<effect_load_request> completed;
+        {
+            std::lock_guard<std::mutex> lock(m_effect_requests_mutex);
+            auto it = std::stable_partition(m_effect_requests.begin(), m_effect_requests.end(),
+                [&url](const effect_load_request& r) { return !is_effect_url(url, r.path); });
+            completed.assign(std::make_move_iterator(it), std::make_move_iterator(m_effect_requests.end()));
+            m_effect_requests.erase(it, m_effect_requests.end());
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (auto& request : completed) {
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - request.start);
+            m_metrics->effects_activated.fetch_add(1, std::memory_order_relaxed);
+            m_metrics->last_effect_swap_latency_us.store(latency.count(), std::memory_order_relaxed);
+            BNB_LOG_INFO("Effect " << request.effect << " activated in " << latency.count() / 1000 << " ms");
+            if (request.callback) {
+                request.callback(request.effect);
+            }
+        }
+    }
+
+    void offscreen_effect_player::set_effect_warmup_frames(uint32_t frames)
+    {
+        m_effect_warmup_frames = frames;
+    }
+
+    void offscreen_effect_player::preload_effect(const std::string& effect_path)
+    {
+        if (!effect_path.empty() && !m_prefetch_tracker->prefetched(effect_path)) {
+            prefetch_effect(effect_path);
+        }
+    }
+
+    void offscreen_effect_player::prefetch_effect(const std::string& effect)
+    {
+        m_effect_prefetcher->prefetch(effect, m_resource_paths, [tracker = m_prefetch_tracker, effect](size_t bytes) {
+            if (bytes > 0) {
+                tracker->add(effect);
+            }
+        });
     }
 
     void offscreen_effect_player::unload_effect()
@@ -165,48 +975,129 @@ namespace bnb
                     effect->call_js_method(method, param);
                 }
                 else {
-                    std::cout << "[Error] effect not loaded" << std::endl;
+                    BNB_LOG_ERROR("effect not loaded");
                 }
             }
             else {
-                std::cout << "[Error] effect manager not initialized" << std::endl;
+                BNB_LOG_ERROR("effect manager not initialized");
             }
         };
 
-        m_scheduler.enqueue(task);
+        m_scheduler->enqueue(task);
     }
 
-    void offscreen_effect_player::read_current_buffer(std::function<void(bnb::data_t data)> callback)
+    void offscreen_effect_player::flush(std::function<void()> callback)
     {
-        if (std::this_thread::get_id() == render_thread_id) {
-            callback(m_ort->read_current_buffer());
-            return;
-        }
-
-        oep_wptr this_ = shared_from_this();
-        auto task = [this_, callback]() {
-            if (auto this_sp = this_.lock()) {
-                callback(this_sp->m_ort->read_current_buffer());
+        // Readback tasks are queued by render tasks, so the readback thread is drained after the render one
+        auto task = [this, callback]() {
+            if (m_readback_scheduler != nullptr) {
+                m_readback_scheduler->enqueue(callback);
+            } else {
+                callback();
             }
         };
-        m_scheduler.enqueue(task);
+
+        m_scheduler->enqueue(task);
     }
 
-    void offscreen_effect_player::get_current_buffer_texture(oep_texture_cb callback)
+    interfaces::oep_metrics offscreen_effect_player::get_metrics()
     {
-        if (std::this_thread::get_id() == render_thread_id) {
-            callback(m_ort->get_current_buffer_texture());
+        auto metrics = m_metrics->snapshot();
+        metrics.queue_depth = m_incoming_frame_queue_task_count.load();
+        return metrics;
+    }
+
+    void offscreen_effect_player::report_render_stages()
+    {
+        using namespace std::chrono_literals;
+
+        auto profiler = gl::gpu_profiler::current();
+        if (!gl::gpu_profiler::is_enabled() || profiler == nullptr) {
             return;
         }
 
-        oep_wptr this_ = shared_from_this();
-        auto task = [this_, callback]() {
-            if (auto this_sp = this_.lock()) {
-                callback(this_sp->m_ort->get_current_buffer_texture());
-            }
-        };
-        m_scheduler.enqueue(task);
+        auto now = std::chrono::steady_clock::now();
+        if (now - m_last_stages_report < 5s) {
+            return;
+        }
+        m_last_stages_report = now;
+
+        // A line per stage, the whole report doesn't fit into a log message
+        for (const auto& stage : profiler->get_stats()) {
+            BNB_LOG_INFO("Render stage " << stage.name << ": cpu " << stage.cpu_ms_avg << " ms, gpu "
+                << stage.gpu_ms_avg << " ms" << (stage.gpu_ms_avg > stage.cpu_ms_avg ? " (gpu-bound)" : ""));
+        }
     }
 
+    void offscreen_effect_player::read_current_buffer(std::function<void(bnb::data_t data)> callback)
+    {
+        run_on_render_thread([callback](offscreen_effect_player& oep) {
+            auto data = oep.m_ort->read_current_buffer();
+            oep.m_metrics->bytes_read_back.fetch_add(data.size, std::memory_order_relaxed);
+            callback(std::move(data));
+        });
+    }
+
+    void offscreen_effect_player::read_layer(size_t layer, std::function<void(bnb::data_t data)> callback)
+    {
+        run_on_render_thread([layer, callback](offscreen_effect_player& oep) {
+            auto data = oep.m_ort->read_layer(layer);
+            oep.m_metrics->bytes_read_back.fetch_add(data.size, std::memory_order_relaxed);
+            callback(std::move(data));
+        });
+    }
+
+    void offscreen_effect_player::read_region(const interfaces::image_rect& region, int32_t width, int32_t height,
+                                              std::function<void(bnb::data_t data)> callback)
+    {
+        run_on_render_thread([region, width, height, callback](offscreen_effect_player& oep) {
+            auto data = oep.m_ort->read_region(region, width, height);
+            oep.m_metrics->bytes_read_back.fetch_add(data.size, std::memory_order_relaxed);
+            callback(std::move(data));
+        });
+    }
+
+    void offscreen_effect_player::read_published(const interfaces::published_frame& frame,
+                                                 const interfaces::image_rect& region, int32_t width, int32_t height,
+                                                 interfaces::scale_filter filter,
+                                                 std::function<void(bnb::data_t data)> callback)
+    {
+        run_on_readback_thread([frame, region, width, height, filter, callback](offscreen_effect_player& oep) {
+            auto data = oep.m_ort->read_published(frame, region, width, height, filter);
+            oep.m_metrics->bytes_read_back.fetch_add(data.size, std::memory_order_relaxed);
+            callback(std::move(data));
+        });
+    }
+
+    void offscreen_effect_player::scale_published(const interfaces::published_frame& frame, size_t target,
+                                                  int32_t width, int32_t height, interfaces::scale_filter filter,
+                                                  oep_texture_cb callback)
+    {
+        run_on_readback_thread([frame, target, width, height, filter, callback](offscreen_effect_player& oep) {
+            callback(oep.m_ort->scale_published(frame, target, width, height, filter));
+        });
+    }
+
+    void offscreen_effect_player::get_current_buffer_texture(oep_texture_cb callback)
+    {
+        run_on_render_thread([callback](offscreen_effect_player& oep) {
+            callback(oep.m_ort->get_current_buffer_texture());
+        });
+    }
+
+    void offscreen_effect_player::get_layer_texture(size_t layer, oep_texture_cb callback)
+    {
+        run_on_render_thread([layer, callback](offscreen_effect_player& oep) {
+            callback(oep.m_ort->get_layer_texture(layer));
+        });
+    }
+
+    void offscreen_effect_player::upload_texture(size_t slot, color_plane rgba, int32_t width, int32_t height,
+                                                 oep_texture_cb callback)
+    {
+        run_on_render_thread([slot, rgba, width, height, callback](offscreen_effect_player& oep) {
+            callback(oep.m_ort->upload_texture(slot, rgba.get(), width, height));
+        });
+    }
 
 } // bnb
@@ -0,0 +1,94 @@
+#include "passthrough.hpp"
+
+#include <libyuv.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    int degrees(bnb::camera_orientation orientation)
+    {
+        switch (orientation) {
+            // clang-format off
+            case bnb::camera_orientation::deg_0:   return 0;
+            case bnb::camera_orientation::deg_90:  return 90;
+            case bnb::camera_orientation::deg_180: return 180;
+            case bnb::camera_orientation::deg_270: return 270;
+            // clang-format on
+        }
+        return 0;
+    }
+
+    void scale(const bnb::i420::buffer& src, const bnb::interfaces::image_rect& rect, bnb::i420::buffer& dst)
+    {
+        auto x = bnb::i420::even(rect.x);
+        auto y = bnb::i420::even(rect.y);
+        auto src_y = src.y + y * src.width + x;
+        auto src_u = src.u + (y / 2) * (src.width / 2) + x / 2;
+        auto src_v = src.v + (y / 2) * (src.width / 2) + x / 2;
+        libyuv::I420Scale(src_y, src.width, src_u, src.width / 2, src_v, src.width / 2, rect.width, rect.height,
+            dst.y, dst.width, dst.u, dst.width / 2, dst.v, dst.width / 2, dst.width, dst.height, libyuv::kFilterBilinear);
+    }
+} // namespace
+
+namespace bnb::passthrough
+{
+    const i420::buffer& render(const frame& f, int32_t output_width, int32_t output_height,
+                               const interfaces::image_rect& region, int32_t width, int32_t height)
+    {
+        // Two scratch buffers are swapped between steps, so only changed stages copy pixels
+        thread_local i420::buffer first;
+        thread_local i420::buffer second;
+        auto* current = &first;
+        auto* next = &second;
+
+        auto format = f.source->get_format();
+        auto source_width = i420::even(int32_t(format.width));
+        auto source_height = i420::even(int32_t(format.height));
+        current->resize(source_width, source_height);
+        i420::from_image(*f.source, {0, 0, source_width, source_height}, *current);
+
+        if (format.require_mirroring) {
+            next->resize(current->width, current->height);
+            libyuv::I420Mirror(current->y, current->width, current->u, current->width / 2, current->v, current->width / 2,
+                next->y, next->width, next->u, next->width / 2, next->v, next->width / 2, current->width, current->height);
+            std::swap(current, next);
+        }
+
+        // The effect player turns the source upright, the orientation pass turns it to the target
+        // orientation. Readback from GL is bottom-up, so a frame without y flip is upside down
+        auto rotation = (degrees(f.orient.orientation) - degrees(format.orientation) + 360) % 360;
+        bool flip = !f.orient.is_y_flip;
+        if (rotation != 0 || flip) {
+            bool swap_sides = rotation == 90 || rotation == 270;
+            next->resize(swap_sides ? current->height : current->width, swap_sides ? current->width : current->height);
+            libyuv::I420Rotate(current->y, current->width, current->u, current->width / 2, current->v, current->width / 2,
+                next->y, next->width, next->u, next->width / 2, next->v, next->width / 2,
+                current->width, flip ? -current->height : current->height, libyuv::RotationMode(rotation));
+            std::swap(current, next);
+        }
+
+        output_width = std::max(2, i420::even(output_width));
+        output_height = std::max(2, i420::even(output_height));
+        if (current->width != output_width || current->height != output_height) {
+            next->resize(output_width, output_height);
+            scale(*current, {0, 0, current->width, current->height}, *next);
+            std::swap(current, next);
+        }
+
+        auto x = std::clamp(region.x, 0, output_width - 2);
+        auto y = std::clamp(region.y, 0, output_height - 2);
+        interfaces::image_rect rect{x, y, std::clamp(region.width, 2, output_width - x), std::clamp(region.height, 2, output_height - y)};
+        width = std::max(2, i420::even(width));
+        height = std::max(2, i420::even(height));
+        bool is_whole = rect.x == 0 && rect.y == 0 && rect.width == output_width && rect.height == output_height;
+        if (!is_whole || width != output_width || height != output_height) {
+            next->resize(width, height);
+            scale(*current, rect, *next);
+            std::swap(current, next);
+        }
+
+        return *current;
+    }
+} // bnb::passthrough
@@ -2,26 +2,58 @@
 
 #include <bnb/types/full_image.hpp>
 
-#include <iostream>
+#include "logger.hpp"
+#include "opengl.hpp"
+#include "tracer.hpp"
+
 #include <libyuv.h>
 
+namespace
+{
+    void abgr_to_nv12(const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* y_plane, uint8_t* uv_plane)
+    {
+        libyuv::ABGRToNV12(rgba,
+            width * 4,
+            y_plane,
+            width,
+            uv_plane,
+            width,
+            width,
+            height);
+    }
+
+    // libyuv writes a full chroma pair for the last odd column and row
+    size_t nv12_uv_size(uint32_t width, uint32_t height)
+    {
+        return size_t((width + 1) / 2 * 2) * ((height + 1) / 2);
+    }
+} // namespace
+
 namespace bnb
 {
-    pixel_buffer::pixel_buffer(oep_sptr oep_sptr, uint32_t width, uint32_t height, camera_orientation orientation)
+    pixel_buffer::pixel_buffer(oep_sptr oep_sptr, uint32_t width, uint32_t height, camera_orientation orientation,
+                               std::vector<interfaces::output_layer> layers)
         : m_oep_ptr(oep_sptr)
+        , m_metrics(oep_sptr->m_metrics)
+        , m_plane_pool(oep_sptr->m_plane_pool)
         , m_width(width)
         , m_height(height)
-        , m_orientation(orientation) {}
+        , m_orientation(orientation)
+        , m_layers(std::move(layers)) {}
 
     void pixel_buffer::lock()
     {
-        ++lock_count;
+        if (lock_count++ == 0) {
+            m_metrics->pixel_buffers_in_flight.fetch_add(1, std::memory_order_relaxed);
+        }
     }
 
     void pixel_buffer::unlock()
     {
         if (lock_count > 0) {
-            --lock_count;
+            if (--lock_count == 0) {
+                m_metrics->pixel_buffers_in_flight.fetch_sub(1, std::memory_order_relaxed);
+            }
             return;
         }
 
@@ -39,68 +71,424 @@ namespace bnb
     void pixel_buffer::get_rgba(oep_image_ready_cb callback)
     {
         if (!is_locked()) {
-            std::cout << "[WARNING] The pixel buffer must be locked" << std::endl;
+            BNB_LOG_WARNING("The pixel buffer must be locked");
             callback(std::nullopt);
+            return;
+        }
+
+        if (m_passthrough) {
+            int32_t width = m_width;
+            int32_t height = m_height;
+            auto plane = passthrough_rgba(interfaces::image_rect{0, 0, int32_t(m_width), int32_t(m_height)}, width, height);
+            bnb::image_format frm(width, height, m_orientation, false, 0, std::nullopt);
+            callback(full_image_t(bpc8_image_t(plane, interfaces::pixel_format::rgba, frm)));
+            return;
         }
 
         if (auto oep_sp = m_oep_ptr.lock()) {
             auto convert_callback = [this, callback](data_t data) {
-                bnb::image_format frm(m_width, m_height, m_orientation, false, 0, std::nullopt);
-                auto bpc8 = bpc8_image_t(color_plane_weak(data.data.get()), interfaces::pixel_format::rgba, frm);
-                callback(full_image_t(std::move(bpc8)));
+                convert_to_rgba(std::move(data), m_width, m_height, callback);
             };
 
-            oep_sp->read_current_buffer(convert_callback);
+            if (m_published) {
+                oep_sp->read_published(*m_published, interfaces::image_rect{0, 0, m_published->width, m_published->height}, m_width, m_height,
+                    interfaces::scale_filter::linear, convert_callback);
+            } else {
+                oep_sp->read_current_buffer(convert_callback);
+            }
         } else {
-            std::cout << "[ERROR] Offscreen effect player destroyed" << std::endl;
+            BNB_LOG_ERROR("Offscreen effect player destroyed");
         }
     }
 
     void pixel_buffer::get_nv12(oep_image_ready_cb callback)
     {
         if (!is_locked()) {
-            std::cout << "[WARNING] The pixel buffer must be locked" << std::endl;
+            BNB_LOG_WARNING("The pixel buffer must be locked");
             callback(std::nullopt);
+            return;
+        }
+
+        if (m_passthrough) {
+            callback(passthrough_nv12(interfaces::image_rect{0, 0, int32_t(m_width), int32_t(m_height)}, m_width, m_height));
+            return;
         }
 
         if (auto oep_sp = m_oep_ptr.lock()) {
             auto convert_callback = [this, callback](data_t data) {
-                std::vector<uint8_t> y_plane(m_width * m_height);
-                std::vector<uint8_t> uv_plane((m_width / 2 * m_height / 2) * 2);
-
-                bnb::image_format frm(m_width, m_height, m_orientation, false, 0, std::nullopt);
-
-                libyuv::ABGRToNV12(data.data.get(),
-                    m_width * 4,
-                    y_plane.data(),
-                    m_width,
-                    uv_plane.data(),
-                    m_width,
-                    m_width,
-                    m_height);
-
-                callback(full_image_t(yuv_image_t(color_plane_vector(y_plane), color_plane_vector(uv_plane), frm)));
+                convert_to_nv12(std::move(data), m_width, m_height, callback);
             };
 
-            oep_sp->read_current_buffer(convert_callback);
+            if (m_published) {
+                oep_sp->read_published(*m_published, interfaces::image_rect{0, 0, m_published->width, m_published->height}, m_width, m_height,
+                    interfaces::scale_filter::linear, convert_callback);
+            } else {
+                oep_sp->read_current_buffer(convert_callback);
+            }
         }
         else {
-            std::cout << "[ERROR] Offscreen effect player destroyed" << std::endl;
+            BNB_LOG_ERROR("Offscreen effect player destroyed");
         }
     }
 
     void pixel_buffer::get_texture(oep_texture_cb callback)
     {
         if (!is_locked()) {
-            std::cout << "[WARNING] The pixel buffer must be locked" << std::endl;
+            BNB_LOG_WARNING("The pixel buffer must be locked");
             callback(std::nullopt);
+            return;
+        }
+        if (m_passthrough) {
+            passthrough_texture(0, interfaces::image_rect{0, 0, int32_t(m_width), int32_t(m_height)}, m_width, m_height, callback);
+            return;
+        }
+        if (m_published) {
+            // The copy is complete by the time the frame is delivered
+            callback(m_published->texture);
+            return;
         }
         if (auto oep_sp = m_oep_ptr.lock()) {
             oep_sp->get_current_buffer_texture(callback);
         }
         else {
-            std::cout << "[ERROR] Offscreen effect player destroyed" << std::endl;
+            BNB_LOG_ERROR("Offscreen effect player destroyed");
+        }
+    }
+
+    void pixel_buffer::get_rgba_layer(size_t layer, oep_image_ready_cb callback)
+    {
+        if (!is_locked() || layer >= m_layers.size()) {
+            BNB_LOG_WARNING("The pixel buffer must be locked and have layer " << layer);
+            callback(std::nullopt);
+            return;
+        }
+
+        if (m_passthrough) {
+            int32_t width = m_layers[layer].width;
+            int32_t height = m_layers[layer].height;
+            auto plane = passthrough_rgba(interfaces::image_rect{0, 0, int32_t(m_width), int32_t(m_height)}, width, height);
+            bnb::image_format frm(width, height, m_orientation, false, 0, std::nullopt);
+            callback(full_image_t(bpc8_image_t(plane, interfaces::pixel_format::rgba, frm)));
+            return;
         }
+
+        if (auto oep_sp = m_oep_ptr.lock()) {
+            auto convert_callback = [this, callback, layer](data_t data) {
+                convert_to_rgba(std::move(data), m_layers[layer].width, m_layers[layer].height, callback);
+            };
+
+            if (m_published) {
+                const auto& l = m_layers[layer];
+                oep_sp->read_published(*m_published, interfaces::image_rect{0, 0, m_published->width, m_published->height}, l.width, l.height, l.filter, convert_callback);
+            } else {
+                oep_sp->read_layer(layer, convert_callback);
+            }
+        } else {
+            BNB_LOG_ERROR("Offscreen effect player destroyed");
+        }
+    }
+
+    void pixel_buffer::get_nv12_layer(size_t layer, oep_image_ready_cb callback)
+    {
+        if (!is_locked() || layer >= m_layers.size()) {
+            BNB_LOG_WARNING("The pixel buffer must be locked and have layer " << layer);
+            callback(std::nullopt);
+            return;
+        }
+
+        if (m_passthrough) {
+            callback(passthrough_nv12(interfaces::image_rect{0, 0, int32_t(m_width), int32_t(m_height)}, m_layers[layer].width, m_layers[layer].height));
+            return;
+        }
+
+        if (auto oep_sp = m_oep_ptr.lock()) {
+            auto convert_callback = [this, callback, layer](data_t data) {
+                convert_to_nv12(std::move(data), m_layers[layer].width, m_layers[layer].height, callback);
+            };
+
+            if (m_published) {
+                const auto& l = m_layers[layer];
+                oep_sp->read_published(*m_published, interfaces::image_rect{0, 0, m_published->width, m_published->height}, l.width, l.height, l.filter, convert_callback);
+            } else {
+                oep_sp->read_layer(layer, convert_callback);
+            }
+        } else {
+            BNB_LOG_ERROR("Offscreen effect player destroyed");
+        }
+    }
+
+    void pixel_buffer::get_texture_layer(size_t layer, oep_texture_cb callback)
+    {
+        if (!is_locked() || layer >= m_layers.size()) {
+            BNB_LOG_WARNING("The pixel buffer must be locked and have layer " << layer);
+            callback(std::nullopt);
+            return;
+        }
+
+        if (m_passthrough) {
+            // Slot 0 holds the frame itself
+            passthrough_texture(layer + 1, interfaces::image_rect{0, 0, int32_t(m_width), int32_t(m_height)}, m_layers[layer].width, m_layers[layer].height, callback);
+            return;
+        }
+
+        if (auto oep_sp = m_oep_ptr.lock()) {
+            if (m_published) {
+                const auto& l = m_layers[layer];
+                oep_sp->scale_published(*m_published, layer, l.width, l.height, l.filter, callback);
+                return;
+            }
+            oep_sp->get_layer_texture(layer, callback);
+        } else {
+            BNB_LOG_ERROR("Offscreen effect player destroyed");
+        }
+    }
+
+    void pixel_buffer::get_rgba_region(const interfaces::image_rect& region, int32_t width, int32_t height,
+                                       oep_image_ready_cb callback)
+    {
+        if (!is_locked()) {
+            BNB_LOG_WARNING("The pixel buffer must be locked");
+            callback(std::nullopt);
+            return;
+        }
+
+        if (m_passthrough) {
+            int32_t out_width = width;
+            int32_t out_height = height;
+            auto plane = passthrough_rgba(region, out_width, out_height);
+            bnb::image_format frm(out_width, out_height, m_orientation, false, 0, std::nullopt);
+            callback(full_image_t(bpc8_image_t(plane, interfaces::pixel_format::rgba, frm)));
+            return;
+        }
+
+        if (auto oep_sp = m_oep_ptr.lock()) {
+            auto convert_callback = [this, callback, width, height](data_t data) {
+                convert_to_rgba(std::move(data), width, height, callback);
+            };
+
+            if (m_published) {
+                oep_sp->read_published(*m_published, region, width, height,
+                    interfaces::scale_filter::linear, convert_callback);
+            } else {
+                oep_sp->read_region(region, width, height, convert_callback);
+            }
+        } else {
+            BNB_LOG_ERROR("Offscreen effect player destroyed");
+        }
+    }
+
+    void pixel_buffer::get_nv12_region(const interfaces::image_rect& region, int32_t width, int32_t height,
+                                       oep_image_ready_cb callback)
+    {
+        if (!is_locked()) {
+            BNB_LOG_WARNING("The pixel buffer must be locked");
+            callback(std::nullopt);
+            return;
+        }
+
+        if (width != i420::even(width) || height != i420::even(height)) {
+            BNB_LOG_WARNING("NV12 region size must be even, got " << width << "x" << height);
+            callback(std::nullopt);
+            return;
+        }
+
+        if (m_passthrough) {
+            callback(passthrough_nv12(region, width, height));
+            return;
+        }
+
+        if (auto oep_sp = m_oep_ptr.lock()) {
+            auto convert_callback = [this, callback, width, height](data_t data) {
+                convert_to_nv12(std::move(data), width, height, callback);
+            };
+
+            if (m_published) {
+                oep_sp->read_published(*m_published, region, width, height,
+                    interfaces::scale_filter::linear, convert_callback);
+            } else {
+                oep_sp->read_region(region, width, height, convert_callback);
+            }
+        } else {
+            BNB_LOG_ERROR("Offscreen effect player destroyed");
+        }
+    }
+
+    void pixel_buffer::convert_to_rgba(data_t data, uint32_t width, uint32_t height, oep_image_ready_cb callback)
+    {
+        if (data.size == 0) {
+            callback(std::nullopt);
+            return;
+        }
+
+        BNB_TRACE_SCOPE("rgba_conversion", m_frame_id);
+        auto start = std::chrono::steady_clock::now();
+        bnb::image_format frm(width, height, m_orientation, false, 0, std::nullopt);
+        auto bpc8 = bpc8_image_t(color_plane_weak(data.data.get()), interfaces::pixel_format::rgba, frm);
+        account_conversion(start);
+        callback(full_image_t(std::move(bpc8)));
+    }
+
+    void pixel_buffer::convert_to_nv12(data_t data, uint32_t width, uint32_t height, oep_image_ready_cb callback)
+    {
+        if (data.size == 0) {
+            callback(std::nullopt);
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto y_plane = m_plane_pool->acquire(width * height);
+        auto uv_plane = m_plane_pool->acquire(nv12_uv_size(width, height));
+
+        bnb::image_format frm(width, height, m_orientation, false, 0, std::nullopt);
+
+        {
+            BNB_TRACE_SCOPE("nv12_conversion", m_frame_id);
+            // CPU-only stage, reported next to GPU stages for comparison
+            BNB_GL_SCOPE("nv12_conversion");
+            abgr_to_nv12(data.data.get(), width, height, y_plane.get(), uv_plane.get());
+        }
+        account_conversion(start);
+
+        callback(full_image_t(yuv_image_t(y_plane, uv_plane, frm)));
+    }
+
+    uint64_t pixel_buffer::get_frame_id()
+    {
+        return m_frame_id;
+    }
+
+    void pixel_buffer::set_frame_id(uint64_t frame_id)
+    {
+        m_frame_id = frame_id;
+    }
+
+    interfaces::frame_timing pixel_buffer::get_frame_timing()
+    {
+        return m_frame_timing;
+    }
+
+    void pixel_buffer::set_frame_timing(const interfaces::frame_timing& timing)
+    {
+        m_frame_timing = timing;
+    }
+
+    void pixel_buffer::set_passthrough(std::optional<passthrough::frame> frame)
+    {
+        m_passthrough = std::move(frame);
+    }
+
+    void pixel_buffer::set_published(std::optional<interfaces::published_frame> frame)
+    {
+        m_published = frame;
+    }
+
+    size_t pixel_buffer::nv12_size(int32_t width, int32_t height)
+    {
+        return size_t(width) * height + nv12_uv_size(uint32_t(width), uint32_t(height));
+    }
+
+    size_t pixel_buffer::write_nv12(uint8_t* out, size_t capacity, int32_t& width, int32_t& height)
+    {
+        auto oep_sp = m_oep_ptr.lock();
+        if (!is_locked() || oep_sp == nullptr) {
+            return 0;
+        }
+
+        width = int32_t(m_width);
+        height = int32_t(m_height);
+        const i420::buffer* i420 = nullptr;
+        if (m_passthrough) {
+            i420 = &passthrough::render(*m_passthrough, m_width, m_height, {0, 0, width, height}, width, height);
+            width = i420->width;
+            height = i420->height;
+        }
+
+        // Slots are read with the UV stride equal to the width
+        if (width != i420::even(width) || height != i420::even(height)) {
+            return 0;
+        }
+        auto size = nv12_size(width, height);
+        if (size > capacity) {
+            return 0;
+        }
+        auto y_plane = out;
+        auto uv_plane = out + size_t(width) * height;
+
+        BNB_TRACE_SCOPE("nv12_write", m_frame_id);
+        auto start = std::chrono::steady_clock::now();
+        if (i420 != nullptr) {
+            libyuv::I420ToNV12(i420->y, i420->width, i420->u, i420->width / 2, i420->v, i420->width / 2,
+                y_plane, width, uv_plane, width, width, height);
+            account_conversion(start);
+            return size;
+        }
+
+        // Reads run immediately on the delivering thread, so the callback may capture locals
+        bool written = false;
+        auto convert_callback = [&](data_t data) {
+            if (data.size == size_t(width) * height * 4) {
+                abgr_to_nv12(data.data.get(), uint32_t(width), uint32_t(height), y_plane, uv_plane);
+                written = true;
+            }
+        };
+        if (m_published) {
+            oep_sp->read_published(*m_published, interfaces::image_rect{0, 0, m_published->width, m_published->height},
+                width, height, interfaces::scale_filter::linear, convert_callback);
+        } else {
+            oep_sp->read_current_buffer(convert_callback);
+        }
+        if (!written) {
+            return 0;
+        }
+        account_conversion(start);
+        return size;
+    }
+
+    color_plane pixel_buffer::passthrough_rgba(const interfaces::image_rect& region, int32_t& width, int32_t& height)
+    {
+        BNB_TRACE_SCOPE("passthrough_rgba", m_frame_id);
+        auto start = std::chrono::steady_clock::now();
+        const auto& i420 = passthrough::render(*m_passthrough, m_width, m_height, region, width, height);
+        width = i420.width;
+        height = i420.height;
+        auto plane = m_plane_pool->acquire(size_t(width) * height * 4);
+        libyuv::I420ToABGR(i420.y, i420.width, i420.u, i420.width / 2, i420.v, i420.width / 2,
+            plane.get(), width * 4, width, height);
+        account_conversion(start);
+        return plane;
+    }
+
+    full_image_t pixel_buffer::passthrough_nv12(const interfaces::image_rect& region, int32_t width, int32_t height)
+    {
+        BNB_TRACE_SCOPE("passthrough_nv12", m_frame_id);
+        auto start = std::chrono::steady_clock::now();
+        const auto& i420 = passthrough::render(*m_passthrough, m_width, m_height, region, width, height);
+        auto y_plane = m_plane_pool->acquire(size_t(i420.width) * i420.height);
+        auto uv_plane = m_plane_pool->acquire(size_t(i420.width) * i420.height / 2);
+        libyuv::I420ToNV12(i420.y, i420.width, i420.u, i420.width / 2, i420.v, i420.width / 2,
+            y_plane.get(), i420.width, uv_plane.get(), i420.width, i420.width, i420.height);
+        account_conversion(start);
+
+        bnb::image_format frm(i420.width, i420.height, m_orientation, false, 0, std::nullopt);
+        return full_image_t(yuv_image_t(y_plane, uv_plane, frm));
+    }
+
+    void pixel_buffer::passthrough_texture(size_t slot, const interfaces::image_rect& region, int32_t width,
+                                           int32_t height, oep_texture_cb callback)
+    {
+        auto plane = passthrough_rgba(region, width, height);
+        if (auto oep_sp = m_oep_ptr.lock()) {
+            oep_sp->upload_texture(slot, plane, width, height, callback);
+        } else {
+            BNB_LOG_ERROR("Offscreen effect player destroyed");
+        }
+    }
+
+    void pixel_buffer::account_conversion(std::chrono::steady_clock::time_point start)
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        m_metrics->conversions.fetch_add(1, std::memory_order_relaxed);
+        m_metrics->conversion_time_us.fetch_add(elapsed.count(), std::memory_order_relaxed);
     }
 
 } // bnb
@@ -0,0 +1,49 @@
+#include "plane_pool.hpp"
+
+namespace bnb
+{
+    plane_pool::plane_pool(metrics_counters_sptr metrics, size_t max_free_planes)
+        : m_metrics(std::move(metrics))
+        , m_max_free_planes(max_free_planes) {}
+
+    color_plane plane_pool::acquire(size_t size)
+    {
+        std::unique_ptr<buffer> plane;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto it = m_free_planes.begin(); it != m_free_planes.end(); ++it) {
+                if ((*it)->size() == size) {
+                    plane = std::move(*it);
+                    m_free_planes.erase(it);
+                    break;
+                }
+            }
+        }
+
+        if (plane) {
+            m_metrics->allocations_avoided.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            plane = std::make_unique<buffer>(size);
+        }
+
+        std::weak_ptr<plane_pool> pool = shared_from_this();
+        auto raw = plane.release();
+        return color_plane(raw->data(), [pool, raw](uint8_t*) {
+            if (auto pool_sp = pool.lock()) {
+                pool_sp->release(raw);
+            } else {
+                delete raw;
+            }
+        });
+    }
+
+    void plane_pool::release(buffer* plane)
+    {
+        std::unique_ptr<buffer> holder(plane);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_free_planes.size() < m_max_free_planes) {
+            m_free_planes.push_back(std::move(holder));
+        }
+    }
+} // bnb
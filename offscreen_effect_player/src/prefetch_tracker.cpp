@@ -0,0 +1,33 @@
+#include "prefetch_tracker.hpp"
+
+namespace bnb
+{
+    std::shared_ptr<prefetch_tracker> prefetch_tracker::instance()
+    {
+        static std::mutex mutex;
+        static std::weak_ptr<prefetch_tracker> instance;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto tracker = instance.lock();
+        if (tracker == nullptr) {
+            tracker = std::make_shared<prefetch_tracker>();
+            instance = tracker;
+        }
+        return tracker;
+    }
+
+    bool prefetch_tracker::prefetched(const std::string& effect)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_effects.count(effect) != 0;
+    }
+
+    void prefetch_tracker::add(const std::string& effect)
+    {
+        if (effect.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_effects.insert(effect);
+    }
+} // bnb
@@ -0,0 +1,81 @@
+#include "resolution_governor.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr double ewma_alpha = 0.1;
+    // Render time is compared to these fractions of the frame budget
+    constexpr double high_watermark = 0.9;
+    constexpr double low_watermark = 0.6;
+    // Going down reacts fast to avoid drops, going up waits to be sure the load is gone
+    constexpr uint32_t frames_to_decrease = 8;
+    constexpr uint32_t frames_to_increase = 90;
+    // Frames after a change are slower because of reallocated framebuffers
+    constexpr uint32_t cooldown_frames = 15;
+} // namespace
+
+namespace bnb
+{
+    resolution_governor::resolution_governor(interfaces::resolution_governor_config config)
+    {
+        set_config(config);
+    }
+
+    void resolution_governor::set_config(const interfaces::resolution_governor_config& config)
+    {
+        m_config = config;
+        m_config.max_scale = std::clamp(m_config.max_scale, 0.1f, 1.0f);
+        m_config.min_scale = std::clamp(m_config.min_scale, 0.1f, m_config.max_scale);
+        m_config.scale_step = std::max(m_config.scale_step, 0.01f);
+        m_config.target_fps = std::max(m_config.target_fps, 1.0f);
+        reset();
+    }
+
+    void resolution_governor::reset()
+    {
+        m_scale = m_config.enabled ? m_config.max_scale : 1.0f;
+        m_average_us = 0.0;
+        m_frames_over = 0;
+        m_frames_under = 0;
+        m_cooldown = cooldown_frames;
+    }
+
+    std::optional<float> resolution_governor::on_frame(std::chrono::microseconds render_time)
+    {
+        if (!m_config.enabled) {
+            return std::nullopt;
+        }
+
+        auto us = double(render_time.count());
+        m_average_us = m_average_us == 0.0 ? us : ewma_alpha * us + (1.0 - ewma_alpha) * m_average_us;
+        if (m_cooldown > 0) {
+            --m_cooldown;
+            return std::nullopt;
+        }
+
+        auto budget_us = 1e6 / m_config.target_fps;
+        m_frames_over = m_average_us > budget_us * high_watermark ? m_frames_over + 1 : 0;
+        m_frames_under = m_average_us < budget_us * low_watermark ? m_frames_under + 1 : 0;
+
+        if (m_frames_over >= frames_to_decrease && m_scale > m_config.min_scale) {
+            return change_scale(std::max(m_scale - m_config.scale_step, m_config.min_scale));
+        }
+        if (m_frames_under >= frames_to_increase && m_scale < m_config.max_scale) {
+            return change_scale(std::min(m_scale + m_config.scale_step, m_config.max_scale));
+        }
+        return std::nullopt;
+    }
+
+    float resolution_governor::change_scale(float scale)
+    {
+        // Render time is roughly proportional to the pixel count
+        auto ratio = double(scale) / m_scale;
+        m_average_us *= ratio * ratio;
+        m_scale = scale;
+        m_frames_over = 0;
+        m_frames_under = 0;
+        m_cooldown = cooldown_frames;
+        return m_scale;
+    }
+} // bnb
@@ -5,6 +5,7 @@
 #include "interfaces/offscreen_render_target.hpp"
 
 #include "program.hpp"
+#include "gpu_profiler.hpp"
 
 #include <glad/glad.h>
 #define GLFW_INCLUDE_NONE
@@ -29,7 +30,11 @@ namespace bnb
     class offscreen_render_target : public interfaces::offscreen_render_target
     {
     public:
-        offscreen_render_target(uint32_t width, uint32_t height);
+        /**
+         * @param readback_context create a second shared context, so frames can be read back
+         * on another thread while the next frame is rendered
+         */
+        offscreen_render_target(uint32_t width, uint32_t height, bool readback_context = false);
 
         ~offscreen_render_target();
 
@@ -37,6 +42,8 @@ namespace bnb
         void deinit() override;
 
         void surface_changed(int32_t width, int32_t height) override;
+        void set_output_size(int32_t width, int32_t height) override;
+        void set_output_layers(const std::vector<interfaces::output_layer>& layers) override;
 
         void activate_context() override;
         void deactivate_context() override;
@@ -45,32 +52,114 @@ namespace bnb
         interfaces::oep_sharing_context get_sharing_context() override;
 
         bnb::data_t read_current_buffer() override;
+        bnb::data_t read_layer(size_t layer) override;
+        int get_layer_texture(size_t layer) override;
+        bnb::data_t read_region(const interfaces::image_rect& region, int32_t width, int32_t height) override;
+        bnb::data_t read_texture(int32_t texture_id, interfaces::oep_sync fence, int32_t width, int32_t height) override;
 
         int get_current_buffer_texture() override;
+
+        int upload_texture(size_t slot, const uint8_t* rgba, int32_t width, int32_t height) override;
+
+        bool has_readback_context() override;
+        void activate_readback_context() override;
+        void deinit_readback_context() override;
+        interfaces::published_frame publish_frame(size_t slot) override;
+        void wait_published(interfaces::published_frame& frame) override;
+        bnb::data_t read_published(const interfaces::published_frame& frame, const interfaces::image_rect& region,
+                                   int32_t width, int32_t height, interfaces::scale_filter filter) override;
+        int scale_published(const interfaces::published_frame& frame, size_t target,
+                            int32_t width, int32_t height, interfaces::scale_filter filter) override;
     private:
+        struct layer
+        {
+            interfaces::output_layer format;
+            GLuint texture{ 0 };
+            GLuint framebuffer{ 0 };
+            // Frame the texture content belongs to
+            uint64_t frame{ 0 };
+        };
+
+        // Texture with a framebuffer to render or blit into
+        struct texture_target
+        {
+            GLuint texture{ 0 };
+            GLuint framebuffer{ 0 };
+            int32_t width{ 0 };
+            int32_t height{ 0 };
+        };
+
         void create_context();
         void load_glad_functions();
 
-        void generate_texture(GLuint& texture);
+        void generate_texture(GLuint& texture, uint32_t width, uint32_t height);
         void prepare_post_processing_rendering();
 
         void delete_textures();
+        void delete_layers();
+
+        // Reallocates the texture if the size differs, the framebuffer is created in the current context
+        void ensure_target(texture_target& target, int32_t width, int32_t height);
+        void delete_target(texture_target& target);
+
+        // Crops and scales the source through the scratch target when needed and reads the result
+        bnb::data_t read_scaled(GLuint source_framebuffer, int32_t source_width, int32_t source_height,
+                                const interfaces::image_rect& region, int32_t width, int32_t height,
+                                GLenum filter, texture_target& scratch);
+
+        // Renders the layer from the output texture if it is not rendered for the current frame yet
+        layer* produce_layer(size_t index);
 
         uint32_t m_width;
         uint32_t m_height;
+        // Zero means the surface size
+        uint32_t m_output_width{ 0 };
+        uint32_t m_output_height{ 0 };
+        // Size of the texture read by read_current_buffer
+        uint32_t m_active_width{ 0 };
+        uint32_t m_active_height{ 0 };
 
         GLuint m_framebuffer{ 0 };
         GLuint m_post_processing_framebuffer{ 0 };
+        GLuint m_input_framebuffer{ 0 };
         GLuint m_offscreen_render_texture{ 0 };
         GLuint m_offscreen_post_processuing_render_texture{ 0 };
 
         GLuint m_active_texture{0};
+        GLuint m_active_framebuffer{0};
+
+        std::vector<layer> m_layers;
+        GLuint m_layer_source_framebuffer{ 0 };
+
+        // Scratch target of read_region, grows to the largest requested size
+        texture_target m_region;
+
+        struct upload_slot
+        {
+            GLuint texture{ 0 };
+            int32_t width{ 0 };
+            int32_t height{ 0 };
+        };
+        std::vector<upload_slot> m_upload_textures;
+        // Incremented by prepare_rendering, layers and mip chain are valid for one frame
+        uint64_t m_frame{ 0 };
+        uint64_t m_mipmap_frame{ 0 };
 
         smart_GLFWwindow m_renderer_context;
 
+        // Copies of frame outputs being read on the readback thread, rendering context objects
+        std::vector<texture_target> m_published;
+        // Framebuffers aren't shared between contexts, the readback context has its own
+        smart_GLFWwindow m_readback_context;
+        GLuint m_readback_source_framebuffer{ 0 };
+        texture_target m_readback_scratch;
+        std::vector<texture_target> m_readback_targets;
+
         std::unique_ptr<program> m_program;
         std::unique_ptr<ort_frame_surface_handler> m_frame_surface_handler;
 
+        gl::gpu_profiler m_profiler;
+
         std::once_flag m_init_flag;
         std::once_flag m_deinit_flag;
     };
@@ -1,10 +1,13 @@
 #include "offscreen_render_target.hpp"
 
 #include "opengl.hpp"
+#include "logger.hpp"
 
 #include <bnb/effect_player/utility.hpp>
 #include <bnb/postprocess/interfaces/postprocess_helper.hpp>
 
+#include <algorithm>
+
 namespace bnb
 {
     const char* vs_default_base =
@@ -205,13 +208,28 @@ namespace bnb
     extern void run_on_main_queue(std::function<void()> f);
 #endif
 
+namespace
+{
+    // Upper bound of waiting for a published frame, the copy is a single blit
+    constexpr GLuint64 publish_timeout_ns = 1000000000;
+
+    GLenum gl_filter(bnb::interfaces::scale_filter filter)
+    {
+        return filter == bnb::interfaces::scale_filter::nearest ? GL_NEAREST : GL_LINEAR;
+    }
+} // namespace
+
 namespace bnb
 {
-    offscreen_render_target::offscreen_render_target(uint32_t width, uint32_t height)
+    offscreen_render_target::offscreen_render_target(uint32_t width, uint32_t height, bool readback_context)
         : m_width(width)
         , m_height(height) 
     {
         create_context();
+        if (readback_context) {
+            // Created while the rendering context isn't current anywhere, required for sharing on Windows
+            m_readback_context = smart_GLFWwindow(glfwCreateWindow(1, 1, "", nullptr, m_renderer_context.get()));
+        }
     }
 
     offscreen_render_target::~offscreen_render_target()
@@ -230,6 +248,20 @@ namespace bnb
         }
     }
 
+    void offscreen_render_target::delete_layers()
+    {
+        for (auto& l : m_layers) {
+            if (l.texture != 0) {
+                GL_CALL(glDeleteTextures(1, &l.texture));
+                l.texture = 0;
+            }
+            if (l.framebuffer != 0) {
+                GL_CALL(glDeleteFramebuffers(1, &l.framebuffer));
+                l.framebuffer = 0;
+            }
+        }
+    }
+
     void offscreen_render_target::init()
     {
         activate_context();
@@ -239,9 +271,7 @@ namespace bnb
 
             GL_CALL(glGenFramebuffers(1, &m_framebuffer));
             GL_CALL(glGenFramebuffers(1, &m_post_processing_framebuffer));
-
-            m_program = std::make_unique<program>("OrientationChange", vs_default_base, ps_default_base);
-            m_frame_surface_handler = std::make_unique<ort_frame_surface_handler>(bnb::camera_orientation::deg_0, false);
+            // Orientation program is compiled on the first frame that needs it, many pipelines never do
         });
 
         deactivate_context();
@@ -252,6 +282,7 @@ namespace bnb
         activate_context();
 
         std::call_once(m_deinit_flag, [this]() {
+            m_profiler.release();
             m_program.reset();
             m_frame_surface_handler.reset();
             if (m_framebuffer != 0) {
@@ -262,6 +293,26 @@ namespace bnb
                 GL_CALL(glDeleteFramebuffers(1, &m_post_processing_framebuffer));
                 m_post_processing_framebuffer = 0;
             }
+            if (m_input_framebuffer != 0) {
+                GL_CALL(glDeleteFramebuffers(1, &m_input_framebuffer));
+                m_input_framebuffer = 0;
+            }
+            if (m_layer_source_framebuffer != 0) {
+                GL_CALL(glDeleteFramebuffers(1, &m_layer_source_framebuffer));
+                m_layer_source_framebuffer = 0;
+            }
+            delete_layers();
+            delete_target(m_region);
+            for (auto& target : m_published) {
+                delete_target(target);
+            }
+            m_published.clear();
+            for (auto& slot : m_upload_textures) {
+                if (slot.texture != 0) {
+                    GL_CALL(glDeleteTextures(1, &slot.texture));
+                }
+            }
+            m_upload_textures.clear();
             delete_textures();
         });
 
@@ -273,22 +324,44 @@ namespace bnb
         m_width = width;
         m_height = height;
 
-        m_renderer_context.reset();
-
-        auto create_context_task = [this]() {
+        auto resize_window_task = [this]() {
             glfwSetWindowSize(m_renderer_context.get(), m_width, m_height);
         };
 
         #ifdef __APPLE__
-            run_on_main_queue(create_context_task);
+            run_on_main_queue(resize_window_task);
         #else
-            create_context_task();
+            resize_window_task();
         #endif
 
         activate_context();
         delete_textures();
     }
 
+    void offscreen_render_target::set_output_size(int32_t width, int32_t height)
+    {
+        m_output_width = width;
+        m_output_height = height;
+
+        // Recreated with the new size on next frame
+        if (m_offscreen_post_processuing_render_texture != 0) {
+            activate_context();
+            GL_CALL(glDeleteTextures(1, &m_offscreen_post_processuing_render_texture));
+            m_offscreen_post_processuing_render_texture = 0;
+        }
+    }
+
+    void offscreen_render_target::set_output_layers(const std::vector<interfaces::output_layer>& layers)
+    {
+        activate_context();
+        delete_layers();
+
+        m_layers.clear();
+        for (const auto& format : layers) {
+            m_layers.push_back(layer{format});
+        }
+    }
+
     void offscreen_render_target::create_context()
     {
         glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
@@ -305,13 +378,18 @@ namespace bnb
 
     void offscreen_render_target::deactivate_context()
     {
+        gl::gpu_profiler::make_current(nullptr);
         glfwMakeContextCurrent(nullptr);
     }
 
     void offscreen_render_target::activate_context()
     {
         if (m_renderer_context) {
-            glfwMakeContextCurrent(m_renderer_context.get());
+            // A thread of shared render pool switches contexts only when it moves to another session
+            if (glfwGetCurrentContext() != m_renderer_context.get()) {
+                glfwMakeContextCurrent(m_renderer_context.get());
+            }
+            gl::gpu_profiler::make_current(&m_profiler);
         }
     }
 
@@ -328,22 +406,25 @@ namespace bnb
         }
     }
 
-    void offscreen_render_target::generate_texture(GLuint& texture)
+    void offscreen_render_target::generate_texture(GLuint& texture, uint32_t width, uint32_t height)
     {
         GL_CALL(glGenTextures(1, &texture));
         GL_CALL(glBindTexture(GL_TEXTURE_2D, texture));
-        GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,  m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL));
+        GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL));
 
-        GL_CALL(glTexParameteri(GLenum(GL_TEXTURE_2D), GLenum(GL_TEXTURE_MIN_FILTER), GL_NEAREST));
-        GL_CALL(glTexParameteri(GLenum(GL_TEXTURE_2D), GLenum(GL_TEXTURE_MAG_FILTER), GL_NEAREST));
+        // Same as nearest when sampled 1:1, smooth when orientation pass scales the frame
+        GL_CALL(glTexParameteri(GLenum(GL_TEXTURE_2D), GLenum(GL_TEXTURE_MIN_FILTER), GL_LINEAR));
+        GL_CALL(glTexParameteri(GLenum(GL_TEXTURE_2D), GLenum(GL_TEXTURE_MAG_FILTER), GL_LINEAR));
         GL_CALL(glTexParameterf(GLenum(GL_TEXTURE_2D), GLenum(GL_TEXTURE_WRAP_S), GLfloat(GL_CLAMP_TO_EDGE)));
         GL_CALL(glTexParameterf(GLenum(GL_TEXTURE_2D), GLenum(GL_TEXTURE_WRAP_T), GLfloat(GL_CLAMP_TO_EDGE)));
     }
 
     void offscreen_render_target::prepare_rendering()
     {
+        BNB_GL_SCOPE("prepare_rendering");
+
         if (m_offscreen_render_texture == 0) {
-            generate_texture(m_offscreen_render_texture);
+            generate_texture(m_offscreen_render_texture, m_width, m_height);
         }
 
         GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer));
@@ -351,48 +432,61 @@ namespace bnb
 
         if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
             GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-            std::cout << "[ERROR] Failed to make complete framebuffer object " << status << std::endl;
+            BNB_LOG_ERROR("Failed to make complete framebuffer object " << status);
             return;
         }
         m_active_texture = m_offscreen_render_texture;
+        m_active_framebuffer = m_framebuffer;
+        ++m_frame;
+        m_active_width = m_width;
+        m_active_height = m_height;
     }
 
     void offscreen_render_target::prepare_post_processing_rendering()
     {
+        auto output_width = m_output_width != 0 ? m_output_width : m_width;
+        auto output_height = m_output_height != 0 ? m_output_height : m_height;
+
         if (m_offscreen_post_processuing_render_texture == 0) {
-            generate_texture(m_offscreen_post_processuing_render_texture);
+            generate_texture(m_offscreen_post_processuing_render_texture, output_width, output_height);
         }
         GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, m_post_processing_framebuffer));
         GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_offscreen_post_processuing_render_texture, 0));
 
         if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
             GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-            std::cout << "[ERROR] Failed to make complete post processing framebuffer object " << status << std::endl;
+            BNB_LOG_ERROR("Failed to make complete post processing framebuffer object " << status);
             return;
         }
 
-        GL_CALL(glViewport(0, 0, GLsizei(m_width), GLsizei(m_height)));
+        GL_CALL(glViewport(0, 0, GLsizei(output_width), GLsizei(output_height)));
 
         GL_CALL(glActiveTexture(GLenum(GL_TEXTURE0)));
         GL_CALL(glBindTexture(GL_TEXTURE_2D, m_offscreen_render_texture));
         m_active_texture = m_offscreen_post_processuing_render_texture;
+        m_active_framebuffer = m_post_processing_framebuffer;
+        m_active_width = output_width;
+        m_active_height = output_height;
     }
 
     void offscreen_render_target::orient_image(interfaces::orient_format orient)
     {
+        BNB_GL_SCOPE("orient_image");
+
         GL_CALL(glFlush());
 
-        if (orient.orientation == camera_orientation::deg_0 && !orient.is_y_flip) {
+        bool is_scaled = (m_output_width != 0 && m_output_width != m_width)
+                         || (m_output_height != 0 && m_output_height != m_height);
+        if (orient.orientation == camera_orientation::deg_0 && !orient.is_y_flip && !is_scaled) {
             return;
         }
 
         if (m_program == nullptr) {
-            std::cout << "[ERROR] Not initialization m_program" << std::endl;
-            return;
+            BNB_GL_SCOPE("orient_program_compile");
+            m_program = std::make_unique<program>("OrientationChange", vs_default_base, ps_default_base);
         }
         if (m_frame_surface_handler == nullptr) {
-            std::cout << "[ERROR] Not initialization m_frame_surface_handler" << std::endl;
-            return;
+            m_frame_surface_handler = std::make_unique<ort_frame_surface_handler>(bnb::camera_orientation::deg_0, false);
         }
 
         prepare_post_processing_rendering();
@@ -411,10 +505,209 @@ namespace bnb
     {
         activate_context();
 
-        size_t size = m_width * m_height * 4;
+        BNB_GL_SCOPE("readback");
+
+        size_t size = size_t(m_active_width) * m_active_height * 4;
+        data_t data = data_t{ std::make_unique<uint8_t[]>(size), size };
+
+        // Framebuffer may be unbound by previous readback or layer rendering
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, m_active_framebuffer));
+        GL_CALL(glReadPixels(0, 0, m_active_width, m_active_height, GL_RGBA, GL_UNSIGNED_BYTE, data.data.get()));
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+        return data;
+    }
+
+    offscreen_render_target::layer* offscreen_render_target::produce_layer(size_t index)
+    {
+        if (index >= m_layers.size() || m_active_texture == 0) {
+            return nullptr;
+        }
+
+        auto& l = m_layers[index];
+        if (l.frame == m_frame) {
+            return &l;
+        }
+
+        activate_context();
+        BNB_GL_SCOPE("output_layer");
+
+        auto width = uint32_t(l.format.width);
+        auto height = uint32_t(l.format.height);
+        if (l.texture == 0) {
+            generate_texture(l.texture, width, height);
+            GL_CALL(glGenFramebuffers(1, &l.framebuffer));
+            GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, l.framebuffer));
+            GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, l.texture, 0));
+        }
+        if (m_layer_source_framebuffer == 0) {
+            GL_CALL(glGenFramebuffers(1, &m_layer_source_framebuffer));
+        }
+
+        // Blit from the smallest mip level which is still not smaller than the layer
+        GLint level = 0;
+        if (l.format.filter == interfaces::scale_filter::mipmap) {
+            GL_CALL(glBindTexture(GL_TEXTURE_2D, m_active_texture));
+            if (m_mipmap_frame != m_frame) {
+                GL_CALL(glGenerateMipmap(GL_TEXTURE_2D));
+                m_mipmap_frame = m_frame;
+            }
+            while ((m_active_width >> (level + 1)) >= width && (m_active_height >> (level + 1)) >= height) {
+                ++level;
+            }
+        }
+
+        GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_layer_source_framebuffer));
+        GL_CALL(glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_active_texture, level));
+        GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, l.framebuffer));
+
+        GL_CALL(glBlitFramebuffer(0, 0, GLint(m_active_width >> level), GLint(m_active_height >> level),
+            0, 0, GLint(width), GLint(height), GL_COLOR_BUFFER_BIT, gl_filter(l.format.filter)));
+
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+        l.frame = m_frame;
+        return &l;
+    }
+
+    data_t offscreen_render_target::read_layer(size_t index)
+    {
+        activate_context();
+        auto l = produce_layer(index);
+        if (l == nullptr) {
+            return data_t{ nullptr, 0 };
+        }
+
+        BNB_GL_SCOPE("layer_readback");
+
+        size_t size = size_t(l->format.width) * l->format.height * 4;
         data_t data = data_t{ std::make_unique<uint8_t[]>(size), size };
 
-        GL_CALL(glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, data.data.get()));
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, l->framebuffer));
+        GL_CALL(glReadPixels(0, 0, l->format.width, l->format.height, GL_RGBA, GL_UNSIGNED_BYTE, data.data.get()));
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+        return data;
+    }
+
+    int offscreen_render_target::get_layer_texture(size_t index)
+    {
+        activate_context();
+        auto l = produce_layer(index);
+        if (l == nullptr) {
+            return 0;
+        }
+
+        // Make the blit visible to shared contexts
+        GL_CALL(glFlush());
+        return int(l->texture);
+    }
+
+    data_t offscreen_render_target::read_region(const interfaces::image_rect& region, int32_t width, int32_t height)
+    {
+        if (m_active_texture == 0 || width <= 0 || height <= 0) {
+            return data_t{ nullptr, 0 };
+        }
+
+        activate_context();
+        BNB_GL_SCOPE("region_readback");
+
+        return read_scaled(m_active_framebuffer, int32_t(m_active_width), int32_t(m_active_height),
+            region, width, height, GL_LINEAR, m_region);
+    }
+
+    data_t offscreen_render_target::read_scaled(GLuint source_framebuffer, int32_t source_width, int32_t source_height,
+                                                const interfaces::image_rect& region, int32_t width, int32_t height,
+                                                GLenum filter, texture_target& scratch)
+    {
+        auto x = std::clamp(region.x, 0, source_width - 1);
+        auto y = std::clamp(region.y, 0, source_height - 1);
+        auto w = std::clamp(region.width, 1, source_width - x);
+        auto h = std::clamp(region.height, 1, source_height - y);
+
+        size_t size = size_t(width) * height * 4;
+        data_t data = data_t{ std::make_unique<uint8_t[]>(size), size };
+
+        if (w == width && h == height) {
+            // Plain crop, read directly from the source
+            GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, source_framebuffer));
+            GL_CALL(glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data.data.get()));
+            GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+            return data;
+        }
+
+        if (scratch.width < width || scratch.height < height) {
+            ensure_target(scratch, std::max(scratch.width, width), std::max(scratch.height, height));
+        }
+
+        GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, source_framebuffer));
+        GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, scratch.framebuffer));
+        GL_CALL(glBlitFramebuffer(x, y, x + w, y + h, 0, 0, width, height, GL_COLOR_BUFFER_BIT, filter));
+
+        GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, scratch.framebuffer));
+        GL_CALL(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data.data.get()));
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+        return data;
+    }
+
+    void offscreen_render_target::ensure_target(texture_target& target, int32_t width, int32_t height)
+    {
+        if (target.texture != 0 && target.width == width && target.height == height) {
+            return;
+        }
+        if (target.texture != 0) {
+            GL_CALL(glDeleteTextures(1, &target.texture));
+        }
+        generate_texture(target.texture, uint32_t(width), uint32_t(height));
+        target.width = width;
+        target.height = height;
+
+        if (target.framebuffer == 0) {
+            GL_CALL(glGenFramebuffers(1, &target.framebuffer));
+        }
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer));
+        GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0));
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    }
+
+    void offscreen_render_target::delete_target(texture_target& target)
+    {
+        if (target.framebuffer != 0) {
+            GL_CALL(glDeleteFramebuffers(1, &target.framebuffer));
+        }
+        if (target.texture != 0) {
+            GL_CALL(glDeleteTextures(1, &target.texture));
+        }
+        target = texture_target{};
+    }
+
+    data_t offscreen_render_target::read_texture(int32_t texture_id, interfaces::oep_sync fence, int32_t width, int32_t height)
+    {
+        BNB_GL_SCOPE("input_texture_readback");
+
+        if (fence != nullptr) {
+            auto sync = static_cast<GLsync>(fence);
+            GL_CALL(glWaitSync(sync, 0, GL_TIMEOUT_IGNORED));
+            GL_CALL(glDeleteSync(sync));
+        }
+
+        if (m_input_framebuffer == 0) {
+            GL_CALL(glGenFramebuffers(1, &m_input_framebuffer));
+        }
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, m_input_framebuffer));
+        GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, GLuint(texture_id), 0));
+
+        size_t size = size_t(width) * height * 4;
+        data_t data = data_t{ std::make_unique<uint8_t[]>(size), size };
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+            GL_CALL(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data.data.get()));
+        } else {
+            BNB_LOG_ERROR("Failed to attach input texture " << texture_id);
+        }
+
+        GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0));
         GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 
         return data;
@@ -425,6 +718,160 @@ namespace bnb
         return m_active_texture;
     }
 
+    int offscreen_render_target::upload_texture(size_t slot, const uint8_t* rgba, int32_t width, int32_t height)
+    {
+        if (rgba == nullptr || width <= 0 || height <= 0) {
+            return 0;
+        }
+
+        activate_context();
+        BNB_GL_SCOPE("texture_upload");
+
+        if (m_upload_textures.size() <= slot) {
+            m_upload_textures.resize(slot + 1);
+        }
+        auto& s = m_upload_textures[slot];
+        if (s.texture == 0 || s.width != width || s.height != height) {
+            if (s.texture != 0) {
+                GL_CALL(glDeleteTextures(1, &s.texture));
+            }
+            generate_texture(s.texture, uint32_t(width), uint32_t(height));
+            s.width = width;
+            s.height = height;
+        }
+
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, s.texture));
+        GL_CALL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        // Make the upload visible to shared contexts
+        GL_CALL(glFlush());
+        return int(s.texture);
+    }
+
+    bool offscreen_render_target::has_readback_context()
+    {
+        return m_readback_context != nullptr;
+    }
+
+    void offscreen_render_target::activate_readback_context()
+    {
+        if (m_readback_context && glfwGetCurrentContext() != m_readback_context.get()) {
+            glfwMakeContextCurrent(m_readback_context.get());
+        }
+    }
+
+    void offscreen_render_target::deinit_readback_context()
+    {
+        if (!m_readback_context) {
+            return;
+        }
+
+        activate_readback_context();
+        if (m_readback_source_framebuffer != 0) {
+            GL_CALL(glDeleteFramebuffers(1, &m_readback_source_framebuffer));
+            m_readback_source_framebuffer = 0;
+        }
+        delete_target(m_readback_scratch);
+        for (auto& target : m_readback_targets) {
+            delete_target(target);
+        }
+        m_readback_targets.clear();
+        glfwMakeContextCurrent(nullptr);
+    }
+
+    interfaces::published_frame offscreen_render_target::publish_frame(size_t slot)
+    {
+        if (m_active_texture == 0) {
+            return { slot, 0, 0, 0, nullptr };
+        }
+
+        activate_context();
+        BNB_GL_SCOPE("publish_frame");
+
+        if (m_published.size() <= slot) {
+            m_published.resize(slot + 1);
+        }
+        auto& target = m_published[slot];
+        auto width = int32_t(m_active_width);
+        auto height = int32_t(m_active_height);
+        ensure_target(target, width, height);
+
+        GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_active_framebuffer));
+        GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.framebuffer));
+        GL_CALL(glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+        auto fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // The fence must be submitted before another context waits for it
+        GL_CALL(glFlush());
+        return { slot, int32_t(target.texture), width, height, fence };
+    }
+
+    void offscreen_render_target::wait_published(interfaces::published_frame& frame)
+    {
+        if (frame.fence == nullptr) {
+            return;
+        }
+
+        activate_readback_context();
+        auto sync = static_cast<GLsync>(frame.fence);
+        // Blocks the calling thread rather than the GPU queue, so the texture is complete for any context afterwards
+        if (glClientWaitSync(sync, 0, publish_timeout_ns) == GL_TIMEOUT_EXPIRED) {
+            BNB_LOG_WARNING("Timeout waiting for published frame " << frame.slot);
+        }
+        GL_CALL(glDeleteSync(sync));
+        frame.fence = nullptr;
+    }
+
+    data_t offscreen_render_target::read_published(const interfaces::published_frame& frame,
+                                                   const interfaces::image_rect& region,
+                                                   int32_t width, int32_t height, interfaces::scale_filter filter)
+    {
+        if (frame.texture == 0 || width <= 0 || height <= 0) {
+            return data_t{ nullptr, 0 };
+        }
+
+        activate_readback_context();
+
+        if (m_readback_source_framebuffer == 0) {
+            GL_CALL(glGenFramebuffers(1, &m_readback_source_framebuffer));
+        }
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, m_readback_source_framebuffer));
+        GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, GLuint(frame.texture), 0));
+
+        return read_scaled(m_readback_source_framebuffer, frame.width, frame.height, region, width, height,
+            gl_filter(filter), m_readback_scratch);
+    }
+
+    int offscreen_render_target::scale_published(const interfaces::published_frame& frame, size_t target,
+                                                 int32_t width, int32_t height, interfaces::scale_filter filter)
+    {
+        if (frame.texture == 0 || width <= 0 || height <= 0) {
+            return 0;
+        }
+
+        activate_readback_context();
+
+        if (m_readback_targets.size() <= target) {
+            m_readback_targets.resize(target + 1);
+        }
+        auto& t = m_readback_targets[target];
+        ensure_target(t, width, height);
+
+        if (m_readback_source_framebuffer == 0) {
+            GL_CALL(glGenFramebuffers(1, &m_readback_source_framebuffer));
+        }
+        GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_readback_source_framebuffer));
+        GL_CALL(glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, GLuint(frame.texture), 0));
+        GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, t.framebuffer));
+        GL_CALL(glBlitFramebuffer(0, 0, frame.width, frame.height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, gl_filter(filter)));
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+        // Make the blit visible to shared contexts
+        GL_CALL(glFlush());
+        return int(t.texture);
+    }
+
     interfaces::oep_sharing_context offscreen_render_target::get_sharing_context()
     {
         return m_renderer_context.get();
@@ -0,0 +1,63 @@
+#include "effect_bundle.hpp"
+
+#include <iostream>
+
+namespace
+{
+    void print_usage()
+    {
+        std::cerr << "Usage:" << std::endl
+                  << "    effect_bundler pack <effect_directory> [<bundle>]" << std::endl
+                  << "    effect_bundler unpack <bundle> <directory>" << std::endl
+                  << "    effect_bundler list <bundle>" << std::endl
+                  << "Bundle defaults to <effect_directory>.bnb, the effect player picks it up" << std::endl
+                  << "when the effect directory is absent." << std::endl;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        print_usage();
+        return 1;
+    }
+
+    std::string command = argv[1];
+    if (command == "pack") {
+        std::string directory = argv[2];
+        while (directory.size() > 1 && (directory.back() == '/' || directory.back() == '\\')) {
+            directory.pop_back();
+        }
+        std::string bundle = argc > 3 ? argv[3] : directory + bnb::effect_bundle::extension;
+        if (!bnb::effect_bundle::pack(directory, bundle)) {
+            std::cerr << "Failed to pack " << directory << " into " << bundle << std::endl;
+            return 1;
+        }
+        std::cout << bundle << std::endl;
+        return 0;
+    }
+
+    auto bundle = bnb::effect_bundle::open(argv[2]);
+    if (bundle == nullptr) {
+        std::cerr << argv[2] << " is not a valid effect bundle" << std::endl;
+        return 1;
+    }
+
+    if (command == "unpack" && argc > 3) {
+        if (!bundle->extract(argv[3])) {
+            std::cerr << "Failed to extract " << argv[2] << " to " << argv[3] << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (command == "list") {
+        for (const auto& e : bundle->entries()) {
+            std::cout << e.size << "\t" << e.path << std::endl;
+        }
+        return 0;
+    }
+
+    print_usage();
+    return 1;
+}
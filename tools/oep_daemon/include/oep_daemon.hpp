@@ -0,0 +1,99 @@
+#pragma once
+
+#include "oep_instance_pool.hpp"
+#include "oep_ipc_protocol.hpp"
+#include "shm_frame_ring.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bnb
+{
+    struct oep_daemon_config
+    {
+        std::string socket_path{ipc::default_socket_path};
+        // Group allowed to connect besides the user running the daemon, empty for the user only
+        std::string socket_group;
+        std::vector<std::string> path_to_resources;
+        std::string client_token;
+        // Surface size of the effect players, frames of sessions are scaled to fit it
+        int32_t width{1280};
+        int32_t height{720};
+        // Render threads shared by all sessions
+        size_t render_threads{2};
+        size_t max_sessions{16};
+        // Effect players kept initialized for new sessions, see oep_instance_pool
+        size_t min_idle{1};
+        size_t max_idle{4};
+    };
+
+    /**
+     * Long running process owning GL contexts and effect players of a render host. Clients
+     * connect over a Unix domain socket (see ipc::client in the oep_ipc library), each session
+     * takes an effect player from a pool of warm instances and returns it when closed, so a
+     * client doesn't pay for context creation, SDK initialization and shader compilation.
+     *
+     * All requests are handled on the thread calling run(), frames are only copied out of the
+     * input ring there, the work is done by the effect player threads.
+     *
+     * An input ring is accepted only if it is owned by the user of the connected client, so
+     * a client can't pass a ring of another user or an output ring of the daemon as its input.
+     *
+     * Example
+     *     oep_daemon daemon(config);
+     *     daemon.run();
+     */
+    class oep_daemon
+    {
+    public:
+        explicit oep_daemon(oep_daemon_config config);
+
+        ~oep_daemon();
+
+        oep_daemon(const oep_daemon&) = delete;
+        oep_daemon& operator=(const oep_daemon&) = delete;
+
+        /**
+         * Serve clients until stop() is called.
+         *
+         * @return false if the socket can't be created
+         */
+        bool run();
+
+        /**
+         * Make run() return. Async-signal-safe, may be called from a signal handler
+         */
+        void stop();
+
+    private:
+        struct session
+        {
+            int client_fd;
+            int32_t width;
+            int32_t height;
+            ioep_sptr oep;
+            std::unique_ptr<shm::frame_reader> input;
+        };
+
+        void accept_client();
+        // false when the client disconnected or broke the protocol
+        bool handle_message(int fd);
+        ipc::message create_session(int fd, const ipc::message& request);
+        void destroy_session(uint32_t id);
+        // nullptr if there is no such session or it belongs to another client
+        session* find_session(int fd, uint32_t id);
+        void process_frame(session& s);
+        void close_client(int fd);
+
+        oep_daemon_config m_config;
+        oep_instance_pool_sptr m_pool;
+
+        int m_listen_fd{-1};
+        int m_stop_pipe[2]{-1, -1};
+        std::vector<int> m_clients;
+        std::map<uint32_t, session> m_sessions;
+        uint32_t m_next_session{1};
+    };
+} // bnb
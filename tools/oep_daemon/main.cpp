@@ -0,0 +1,79 @@
+#include "oep_daemon.hpp"
+
+#include "program_binary_cache.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+    bnb::oep_daemon* running_daemon = nullptr;
+
+    void print_usage()
+    {
+        std::cerr << "Usage:" << std::endl
+                  << "    oep_daemon [--socket <path>] [--socket-group <group>] [--size <width>x<height>]" << std::endl
+                  << "               [--render-threads <n>] [--max-sessions <n>]" << std::endl
+                  << "Client token is taken from BNB_CLIENT_TOKEN environment variable. Effect paths" << std::endl
+                  << "of sessions are resolved against the resources folder." << std::endl;
+    }
+
+    void handle_signal(int)
+    {
+        if (running_daemon != nullptr) {
+            running_daemon->stop();
+        }
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bnb::oep_daemon_config config;
+    config.path_to_resources = {BNB_RESOURCES_FOLDER};
+    if (auto token = std::getenv("BNB_CLIENT_TOKEN")) {
+        config.client_token = token;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--socket") {
+            config.socket_path = value;
+        } else if (arg == "--socket-group") {
+            config.socket_group = value;
+        } else if (arg == "--size" && value.find('x') != std::string::npos) {
+            config.width = std::stoi(value.substr(0, value.find('x')));
+            config.height = std::stoi(value.substr(value.find('x') + 1));
+        } else if (arg == "--render-threads") {
+            config.render_threads = std::stoul(value);
+        } else if (arg == "--max-sessions") {
+            config.max_sessions = std::stoul(value);
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    glfwInit();
+
+    // Shader programs linked by one session are reused by the next ones and by the next daemon start
+    if (bnb::program_binary_cache::instance().get_directory().empty()) {
+        bnb::program_binary_cache::instance().set_directory("program_cache");
+    }
+
+    bnb::oep_daemon daemon(config);
+    running_daemon = &daemon;
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+
+    auto served = daemon.run();
+    running_daemon = nullptr;
+    return served ? 0 : 1;
+}
@@ -0,0 +1,288 @@
+#include "oep_daemon.hpp"
+
+#include "logger.hpp"
+#include "offscreen_render_target.hpp"
+#include "render_worker_pool.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr char output_ring_prefix[] = "/oep_daemon_";
+} // namespace
+
+namespace bnb
+{
+    oep_daemon::oep_daemon(oep_daemon_config config)
+        : m_config(std::move(config))
+    {
+        if (pipe2(m_stop_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+            throw std::runtime_error("Failed to create the stop pipe of oep_daemon");
+        }
+
+        oep_instance_pool_config pool_config;
+        pool_config.path_to_resources = m_config.path_to_resources;
+        pool_config.client_token = m_config.client_token;
+        pool_config.width = m_config.width;
+        pool_config.height = m_config.height;
+        pool_config.ort_factory = [width = m_config.width, height = m_config.height]() -> iort_sptr {
+            return std::make_shared<offscreen_render_target>(uint32_t(width), uint32_t(height));
+        };
+        pool_config.render_workers = render_worker_pool::create(std::max<size_t>(m_config.render_threads, 1), "oep_daemon");
+        pool_config.min_idle = m_config.min_idle;
+        pool_config.max_idle = m_config.max_idle;
+        m_pool = oep_instance_pool::create(std::move(pool_config));
+    }
+
+    oep_daemon::~oep_daemon()
+    {
+        // Effect players return to the pool before it is destroyed
+        m_sessions.clear();
+        for (auto fd : m_clients) {
+            close(fd);
+        }
+        if (m_listen_fd >= 0) {
+            close(m_listen_fd);
+            unlink(m_config.socket_path.c_str());
+        }
+        close(m_stop_pipe[0]);
+        close(m_stop_pipe[1]);
+    }
+
+    bool oep_daemon::run()
+    {
+        if (m_listen_fd < 0) {
+            m_listen_fd = ipc::listen_socket(m_config.socket_path, m_config.socket_group);
+            if (m_listen_fd < 0) {
+                BNB_LOG_ERROR("Failed to listen on " << m_config.socket_path);
+                return false;
+            }
+        }
+        BNB_LOG_INFO("Effect player daemon is listening on " << m_config.socket_path);
+
+        std::vector<pollfd> fds;
+        for (;;) {
+            fds.clear();
+            fds.push_back({m_stop_pipe[0], POLLIN, 0});
+            fds.push_back({m_listen_fd, POLLIN, 0});
+            for (auto fd : m_clients) {
+                fds.push_back({fd, POLLIN, 0});
+            }
+
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                BNB_LOG_ERROR("Effect player daemon poll failed " << errno);
+                return false;
+            }
+
+            if (fds[0].revents != 0) {
+                char drained;
+                while (read(m_stop_pipe[0], &drained, 1) > 0) {}
+                return true;
+            }
+            if (fds[1].revents & POLLIN) {
+                accept_client();
+            }
+            for (size_t i = 2; i < fds.size(); ++i) {
+                if (fds[i].revents != 0 && !handle_message(fds[i].fd)) {
+                    close_client(fds[i].fd);
+                }
+            }
+        }
+    }
+
+    void oep_daemon::stop()
+    {
+        char wake = 0;
+        // The pipe is non-blocking, a pending wake-up is enough when it is full
+        (void) !write(m_stop_pipe[1], &wake, 1);
+    }
+
+    void oep_daemon::accept_client()
+    {
+        int fd = accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        m_clients.push_back(fd);
+        BNB_LOG_INFO("Effect player daemon client connected, " << m_clients.size() << " clients");
+    }
+
+    bool oep_daemon::handle_message(int fd)
+    {
+        auto request = ipc::receive_message(fd);
+        if (!request.has_value()) {
+            return false;
+        }
+
+        ipc::message reply;
+        reply.session = request->session;
+        if (request->version != ipc::protocol_version) {
+            reply.result = ipc::status::version_mismatch;
+            ipc::send_message(fd, reply, false);
+            return false;
+        }
+
+        switch (request->type) {
+            case ipc::message_type::frame_ready:
+                // Not answered, the client doesn't wait for anything but the output ring
+                if (auto s = find_session(fd, request->session)) {
+                    process_frame(*s);
+                }
+                return true;
+            case ipc::message_type::create_session:
+                reply = create_session(fd, *request);
+                break;
+            case ipc::message_type::destroy_session:
+                if (find_session(fd, request->session) != nullptr) {
+                    destroy_session(request->session);
+                } else {
+                    reply.result = ipc::status::no_session;
+                }
+                break;
+            case ipc::message_type::load_effect:
+                if (auto s = find_session(fd, request->session)) {
+                    auto effect = request->get_text();
+                    if (effect.empty()) {
+                        s->oep->unload_effect();
+                    } else {
+                        s->oep->load_effect(effect);
+                    }
+                } else {
+                    reply.result = ipc::status::no_session;
+                }
+                break;
+            default:
+                reply.result = ipc::status::bad_request;
+                break;
+        }
+        // All sessions are served by this thread, a client that doesn't read its replies is dropped
+        return ipc::send_message(fd, reply, false);
+    }
+
+    ipc::message oep_daemon::create_session(int fd, const ipc::message& request)
+    {
+        ipc::message reply;
+        if (m_sessions.size() >= m_config.max_sessions) {
+            reply.result = ipc::status::session_limit;
+            return reply;
+        }
+        if (request.width <= 0 || request.height <= 0 || request.width % 2 != 0 || request.height % 2 != 0) {
+            reply.result = ipc::status::bad_request;
+            return reply;
+        }
+
+        auto input = request.get_text().rfind(output_ring_prefix, 0) == 0
+            ? nullptr : shm::frame_reader::open(request.get_text());
+        if (input == nullptr || size_t(input->slot_size()) < size_t(request.width) * size_t(request.height) * 3 / 2) {
+            BNB_LOG_WARNING("Input ring " << request.get_text() << " of a new session can't be opened");
+            reply.result = ipc::status::bad_request;
+            return reply;
+        }
+        // Ring names are easy to guess, the client must have created the ring itself. Output rings
+        // are rejected by name too, they are owned by the user of the daemon, who may run clients as well
+        auto uid = ipc::peer_uid(fd);
+        if (!uid.has_value() || *uid != input->owner()) {
+            BNB_LOG_WARNING("Input ring " << request.get_text() << " of a new session belongs to another user");
+            reply.result = ipc::status::bad_request;
+            return reply;
+        }
+
+        // Creates an instance synchronously only if the pool has run out of idle ones
+        auto oep = m_pool->checkout();
+        if (oep == nullptr) {
+            reply.result = ipc::status::failed;
+            return reply;
+        }
+
+        auto id = m_next_session++;
+        interfaces::shm_output_config output;
+        output.name = output_ring_prefix + std::to_string(getpid()) + "_" + std::to_string(id);
+        output.slots = std::max<uint32_t>(request.slots, 1);
+        output.max_width = request.width;
+        output.max_height = request.height;
+        oep->set_output_size(request.width, request.height);
+        if (!oep->set_shm_output(output)) {
+            BNB_LOG_ERROR("Output ring " << output.name << " can't be created");
+            reply.result = ipc::status::failed;
+            return reply;
+        }
+
+        m_sessions.emplace(id, session{fd, request.width, request.height, std::move(oep), std::move(input)});
+        BNB_LOG_INFO("Effect player daemon session " << id << " created, " << m_sessions.size() << " sessions");
+        reply.session = id;
+        reply.set_text(output.name);
+        return reply;
+    }
+
+    void oep_daemon::destroy_session(uint32_t id)
+    {
+        // The effect player is reset and returns to the pool, its output ring is removed
+        m_sessions.erase(id);
+        BNB_LOG_INFO("Effect player daemon session " << id << " closed, " << m_sessions.size() << " sessions");
+    }
+
+    oep_daemon::session* oep_daemon::find_session(int fd, uint32_t id)
+    {
+        auto it = m_sessions.find(id);
+        // A client can't reach sessions of other clients
+        if (it == m_sessions.end() || it->second.client_fd != fd) {
+            return nullptr;
+        }
+        return &it->second;
+    }
+
+    void oep_daemon::process_frame(session& s)
+    {
+        std::shared_ptr<full_image_t> image;
+        interfaces::frame_timing timing;
+        // The slot may be overwritten by the client any time, the frame is copied out and
+        // discarded if the copy turns out to be torn
+        // Frame info comes from the client process and is checked before the data is touched
+        auto slot_size = size_t(s.input->slot_size());
+        bool read = s.input->read_latest([&s, &image, &timing, slot_size](const shm::frame_info& info, const uint8_t* data) {
+            if (info.width != s.width || info.height != s.height || info.width % 2 != 0 || info.height % 2 != 0) {
+                return;
+            }
+            auto y_size = size_t(info.width) * size_t(info.height);
+            if (y_size * 3 / 2 > slot_size || info.size < y_size * 3 / 2) {
+                return;
+            }
+            auto y_plane = color_plane_vector(std::vector<uint8_t>(data, data + y_size));
+            auto uv_plane = color_plane_vector(std::vector<uint8_t>(data + y_size, data + y_size * 3 / 2));
+            image = std::make_shared<full_image_t>(yuv_image_t(y_plane, uv_plane,
+                image_format(uint32_t(info.width), uint32_t(info.height), camera_orientation::deg_0, false, 0, std::nullopt)));
+            timing.capture_time = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(info.capture_time_ns));
+        });
+        if (!read || image == nullptr) {
+            return;
+        }
+
+        // Processed frames reach the client through the output ring only
+        s.oep->process_image_async(image, [](std::optional<ipb_sptr>) {}, std::nullopt, timing);
+    }
+
+    void oep_daemon::close_client(int fd)
+    {
+        for (auto it = m_sessions.begin(); it != m_sessions.end();) {
+            if (it->second.client_fd == fd) {
+                BNB_LOG_INFO("Effect player daemon session " << it->first << " closed with its client");
+                it = m_sessions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        m_clients.erase(std::remove(m_clients.begin(), m_clients.end(), fd), m_clients.end());
+        close(fd);
+        BNB_LOG_INFO("Effect player daemon client disconnected, " << m_clients.size() << " clients");
+    }
+} // bnb
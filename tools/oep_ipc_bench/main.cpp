@@ -0,0 +1,149 @@
+#include "oep_ipc_client.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    void print_usage()
+    {
+        std::cerr << "Usage:" << std::endl
+                  << "    oep_ipc_bench [--socket <path>] [--size <width>x<height>] [--effect <path>]" << std::endl
+                  << "                  [--sessions <n>] [--frames <n>]" << std::endl
+                  << "Opens sessions on a running oep_daemon, sends synthetic frames through them and prints" << std::endl
+                  << "session creation time and submit to processed frame latency percentiles." << std::endl;
+    }
+
+    int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void print_latency(const char* name, std::vector<int64_t> values)
+    {
+        if (values.empty()) {
+            return;
+        }
+        std::sort(values.begin(), values.end());
+        auto percentile = [&values](double p) {
+            return double(values[size_t(p * double(values.size() - 1))]) / 1e6;
+        };
+        std::cout << name << " ms: p50 " << percentile(0.5) << ", p90 " << percentile(0.9)
+                  << ", p99 " << percentile(0.99) << ", max " << percentile(1.0) << std::endl;
+    }
+
+    // Gray frame with a bright bar moving down, so consecutive frames differ
+    void fill_frame(uint8_t* data, int32_t width, int32_t height, size_t index)
+    {
+        auto y_size = size_t(width) * size_t(height);
+        std::memset(data, 96, y_size);
+        std::memset(data + y_size, 128, y_size / 2);
+        auto bar = size_t(index * 8) % size_t(height);
+        std::memset(data + bar * size_t(width), 235, size_t(width) * std::min<size_t>(8, size_t(height) - bar));
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string socket_path = bnb::ipc::default_socket_path;
+    std::string effect;
+    int32_t width = 1280;
+    int32_t height = 720;
+    size_t sessions = 1;
+    size_t frames = 300;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--socket") {
+            socket_path = value;
+        } else if (arg == "--size" && value.find('x') != std::string::npos) {
+            width = std::stoi(value.substr(0, value.find('x')));
+            height = std::stoi(value.substr(value.find('x') + 1));
+        } else if (arg == "--effect") {
+            effect = value;
+        } else if (arg == "--sessions") {
+            sessions = std::max<size_t>(std::stoul(value), 1);
+        } else if (arg == "--frames") {
+            frames = std::stoul(value);
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    auto client = bnb::ipc::client::connect(socket_path);
+    if (client == nullptr) {
+        std::cerr << "oep_daemon is not running on " << socket_path << std::endl;
+        return 1;
+    }
+
+    std::mutex mutex;
+    std::vector<int64_t> creation_times;
+    std::vector<int64_t> latencies;
+    size_t lost = 0;
+
+    // Each session submits a frame and waits for it to come back before sending the next one
+    auto run_session = [&]() {
+        auto start = now_ns();
+        auto session = client->create_session(width, height, effect);
+        auto created = now_ns();
+        if (session == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::cerr << "Session was refused" << std::endl;
+            return;
+        }
+
+        std::vector<int64_t> session_latencies;
+        size_t session_lost = 0;
+        for (size_t i = 0; i < frames; ++i) {
+            fill_frame(session->begin_frame(), width, height, i);
+            auto submitted = now_ns();
+            if (!session->submit_frame(submitted)) {
+                break;
+            }
+
+            bool received = false;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while (!received && std::chrono::steady_clock::now() < deadline
+                   && session->wait_output(std::chrono::milliseconds(100))) {
+                session->read_output([&](const bnb::shm::frame_info& info, const uint8_t*) {
+                    received = info.capture_time_ns == submitted;
+                });
+            }
+            if (received) {
+                session_latencies.push_back(now_ns() - submitted);
+            } else {
+                ++session_lost;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        creation_times.push_back(created - start);
+        latencies.insert(latencies.end(), session_latencies.begin(), session_latencies.end());
+        lost += session_lost;
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < sessions; ++i) {
+        threads.emplace_back(run_session);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::cout << sessions << " sessions, " << latencies.size() << " frames processed, " << lost << " lost" << std::endl;
+    print_latency("Session creation", creation_times);
+    print_latency("Round trip", latencies);
+    return latencies.empty() ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+#include "shm_frame_ring.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    void print_usage()
+    {
+        std::cerr << "Usage:" << std::endl
+                  << "    shm_frame_reader <name> [<frames>]" << std::endl
+                  << "Reads frames written by offscreen_effect_player::set_shm_output and prints" << std::endl
+                  << "capture to read and publish to read latency percentiles." << std::endl;
+    }
+
+    int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void print_latency(const char* name, std::vector<int64_t> values)
+    {
+        if (values.empty()) {
+            return;
+        }
+        std::sort(values.begin(), values.end());
+        auto percentile = [&values](double p) {
+            return double(values[size_t(p * double(values.size() - 1))]) / 1e6;
+        };
+        std::cout << name << " ms: p50 " << percentile(0.5) << ", p90 " << percentile(0.9)
+                  << ", p99 " << percentile(0.99) << ", max " << percentile(1.0) << std::endl;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    auto reader = bnb::shm::frame_reader::open(argv[1]);
+    if (reader == nullptr) {
+        std::cerr << argv[1] << " is not a frame ring" << std::endl;
+        return 1;
+    }
+
+    size_t frames = argc > 2 ? std::stoul(argv[2]) : 300;
+    std::vector<int64_t> capture_latency;
+    std::vector<int64_t> publish_latency;
+    capture_latency.reserve(frames);
+    publish_latency.reserve(frames);
+
+    uint64_t checksum = 0;
+    while (capture_latency.size() < frames && reader->wait(std::chrono::seconds(5))) {
+        int64_t read_time = 0;
+        bnb::shm::frame_info frame{};
+        auto ok = reader->read_latest([&](const bnb::shm::frame_info& info, const uint8_t* data) {
+            // Touch every cache line of the frame, as a consumer reading it in place would
+            for (uint32_t i = 0; i < info.size; i += 64) {
+                checksum += data[i];
+            }
+            read_time = now_ns();
+            frame = info;
+        });
+        if (ok) {
+            capture_latency.push_back(read_time - frame.capture_time_ns);
+            publish_latency.push_back(read_time - frame.publish_time_ns);
+        }
+    }
+
+    std::cout << capture_latency.size() << " frames read, " << reader->frames_missed() << " missed, "
+              << reader->reads_torn() << " torn (checksum " << checksum << ")" << std::endl;
+    print_latency("capture to read", capture_latency);
+    print_latency("publish to read", publish_latency);
+    return capture_latency.empty() ? 1 : 0;
+}